@@ -55,6 +55,9 @@ constexpr int SEC_per_D     = SEC_per_H * H_per_D;        // seconds per day
 constexpr double Ms_per_FTm = M_per_FT / SEC_per_M;     //1 m/s = 196.85... ft/min
 constexpr double PI         = 3.1415926535897932384626433832795028841971693993751;
 constexpr double EARTH_D_M  = 6371.0 * 2 * 1000;    // earth diameter in meter
+constexpr double RADIO_K_FACTOR = 4.0/3.0;      // effective earth radius factor for VHF radio propagation (standard atmosphere)
+constexpr double RADIO_ANT_STATION_M = 15;      // [m] assumed height of a ground station's antenna above the airport
+constexpr double RADIO_ANT_PLANE_M   = 2;       // [m] assumed height of the plane's antenna above its reference point
 constexpr double JAN_FIRST_2019 = 1546344000;   // 01.01.2019
 constexpr double HPA_STANDARD   = 1013.25;      // air pressure
 constexpr double INCH_STANDARD  = 2992.126;
@@ -79,6 +82,13 @@ extern char PLA_BETA_VER_LIMIT_TXT[];
 constexpr int PLA_NEW_VER_CHECK_TIME = 48;   // [h] between two checks of a new
 
 constexpr float PLA_STARTUP_DELAY = 5.0f;    // [s] before starting to check for COM changes, gives LT time to startup first
+constexpr float PLA_LOOP_FAST   = 0.1f;         // [s] flight loop interval while tuning, buffering, desyncing, or while knobs are moving
+constexpr float PLA_LOOP_NORMAL = 1.0f;         // [s] flight loop interval if nothing is going on
+constexpr float PLA_LOOP_IDLE   = 5.0f;         // [s] flight loop interval if parked and nothing changed for a while
+constexpr int PLA_KNOB_HOLD_S   = 2;            // [s] stay fast that long after a frequency change
+constexpr int PLA_IDLE_AFTER_S  = 30;           // [s] become idle after nothing changed for that long
+constexpr int PLA_TICK_MS       = 1000;         // [ms] interval of the channels' regular tick
+constexpr int PLA_AUDIO_DEV_S   = 60;           // [s] interval of updating the list of audio devices
 
 //MARK: Text Constants
 #define SWITCH_LIVE_ATC         "PlayLiveATC"
@@ -92,10 +102,12 @@ constexpr float PLA_STARTUP_DELAY = 5.0f;    // [s] before starting to check for
 //MARK: Menu Items
 #define MENU_TOGGLE_COM1        "Monitor COM1 change"
 #define MENU_TOGGLE_COM2        "Monitor COM2 change"
+#define MENU_TOGGLE_CHN         "Monitor channel %d change"
 #define MENU_VOLUME_UP          "Volume Up"
 #define MENU_VOLUME_DOWN        "Volume Down"
 #define MENU_MUTE               "Mute"
 #define MENU_AUDIO_DEVICE       "Audio Device"
+#define MENU_AUDIO_ROUTES       "Additional Audio Outputs"
 #define MENU_NO_DEVICE          "(no device)"
 #define MENU_SETTINGS_UI        "Settings..."
 #define MENU_HELP               "Help"
@@ -105,8 +117,10 @@ constexpr float PLA_STARTUP_DELAY = 5.0f;    // [s] before starting to check for
 
 //MARK: Config File Entries
 #define CFG_MONITOR_COM         "MonitorCOM%d"
+#define CFG_CHANNEL             "Channel%d"
 #define CFG_RESPECT_COM_SELECT  "RespectComSelect"
 #define CFG_AUDIO_DEVICE        "AudioDevice"
+#define CFG_AUDIO_ROUTE         "AudioRoute"
 #define CFG_VOLUME              "Volume"
 
 // For Mac and Linux, setting the VLC_PLUGIN_PATH variable has an effect,
@@ -126,6 +140,18 @@ constexpr float PLA_STARTUP_DELAY = 5.0f;    // [s] before starting to check for
 #define CFG_PREBUFFER_STANDBY   "PreBufferStandbyFrequ"
 #define CFG_ATIS_PREF_LIVEATC   "AtisPreferLiveATC"
 #define CFG_MAX_RADIO_DIST      "MaxRadioDist"
+#define CFG_RADIO_HORIZON       "RadioHorizon"
+#define CFG_TERRAIN_LOS         "TerrainLineOfSight"
+#define CFG_PREFETCH_FPLAN      "PrefetchFlightPlan"
+#define CFG_WARM_POOL_SIZE      "WarmPoolSize"
+#define CFG_PREDICT_NEXT        "PredictNextFrequ"
+#define CFG_IDLE_RELEASE        "IdleReleaseSec"
+#define CFG_AUDIO_MIXER         "AudioMixer"
+#define CFG_AUDIO_BUF_MAX_KB    "AudioBufMaxKB"
+#define CFG_AUDIO_BUF_ULAW      "AudioBufULaw"
+#define CFG_RADIO_FX            "RadioEffect"
+#define CFG_AUDIO_DUCK_PCT      "AudioDuckPct"
+#define CFG_REPLAY_MIN          "ReplayMinutes"
 
 #define CFG_LOG_LEVEL           "LogLevel"
 #define CFG_MSG_AREA_LEVEL      "MsgAreaLevel"
@@ -138,6 +164,7 @@ constexpr float PLA_STARTUP_DELAY = 5.0f;    // [s] before starting to check for
 //MARK: File Paths
 // these are under X-Plane's root dir
 #define PATH_CONFIG_FILE        "Output/preferences/PlayLiveATC.prf"
+#define PATH_REPLAY_FILE        "Output/PlayLiveATC_COM%d.replay"
 
 //MARK: Error Texsts
 constexpr long HTTP_OK =            200;
@@ -160,6 +187,7 @@ constexpr int ERR_CFG_FILE_MAXWARN = 5;     // maximum number of warnings while
 #define ERR_CFG_FILE_VER_UNEXP  "Config file '%s' first line: Unexpected version %s, expected %s...trying to continue"
 #define ERR_CFG_FILE_IGNORE     "Ignoring unkown entry '%s' from config file '%s'"
 #define ERR_CFG_FILE_WORDS      "Expected two words (key, value) in config file '%s', line '%s': ignored"
+#define ERR_CFG_CHANNEL         "Channel definition without valid frequency or dataref: '%s', ignored"
 #define ERR_CFG_FILE_READ       "Could not read from '%s': %s"
 #define ERR_CFG_LINE_READ       "Could not read from file '%s', line %d: %s"
 #define ERR_CFG_FILE_TOOMANY    "Too many warnings"
@@ -172,6 +200,8 @@ constexpr int ERR_CFG_FILE_MAXWARN = 5;     // maximum number of warnings while
 // MARK: Processing Info
 #define MSG_STARTUP             SWITCH_LIVE_ATC " %s starting up..."
 #define MSG_DISABLED            SWITCH_LIVE_ATC " disabled"
+#define MSG_ENABLED             SWITCH_LIVE_ATC " enabled in %.0fms, VLC initializes in the background"
+#define MSG_LOOP_STATS          "Flight loop: %lu calls, thereof %lu fast, %lu normal, %lu idle"
 
 //MARK: Debug Texts
 #define DBG_MENU_CREATED        "Menu created"
@@ -183,6 +213,7 @@ constexpr int ERR_CFG_FILE_MAXWARN = 5;     // maximum number of warnings while
 #define DBG_RECEIVED_BYTES      "%s: Received %ld characters"
 #define DBG_SELECTED_MENU_ID    "Selected menu id %lld"
 #define DBG_AVAIL_AUDIO_DEVICE  "Available audio devices:"
+#define DBG_LOOP_INTERVAL       "Flight loop interval now %.1fs"
 #ifdef DEBUG
 #define DBG_DEBUG_BUILD         "DEBUG BUILD with additional run-time checks and no optimizations"
 #endif
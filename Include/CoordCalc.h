@@ -58,9 +58,13 @@ vectorTy CoordVectorBetween (const positionTy& from, const positionTy& to );
 // destination point given a starting point and a vetor
 positionTy CoordPlusVector (const positionTy& pos, const vectorTy& vec);
 
+// radio horizon [m] between two antennas at the given heights [m]
+double RadioHorizon_m (double h1_m, double h2_m);
+
 // returns terrain altitude at given position
 // returns NaN in case of failure
-double YProbe_at_m (const positionTy& posAt, XPLMProbeRef& probeRef);
+double YProbe_at_m (const positionTy& posAt, XPLMProbeRef& probeRef,
+                    bool bLogErr = true);
 
 //
 //MARK: Data Structures
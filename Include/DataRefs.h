@@ -37,13 +37,8 @@ void MenuUpdateCheckmarks();
 // XP standard and LiveTraffic Datarefs being accessed
 enum dataRefsXP_LT {
     // XP standard
-    DR_XP_RADIO_COM1_FREQ = 0,          ///< sim/cockpit/radios/com1_freq_hz
-    DR_XP_RADIO_COM2_FREQ,              ///< sim/cockpit/radios/com2_freq_hz
-    DR_XP_RADIO_COM1_STANDBY_FREQ,      ///< sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833
-    DR_XP_RADIO_COM2_STANDBY_FREQ,      ///< sim/cockpit2/radios/actuators/com2_standby_frequency_hz_833
-    DR_XP_RADIO_COM1_SEL,               ///< sim/cockpit2/radios/actuators/audio_selection_com1
-    DR_XP_RADIO_COM2_SEL,               ///< sim/cockpit2/radios/actuators/audio_selection_com2
-    DR_PLANE_LAT,                       ///< user's plane's position
+    // (COM radio datarefs are bound per channel, see ComBindingTy)
+    DR_PLANE_LAT = 0,                   ///< user's plane's position
     DR_PLANE_LON,
     DR_PLANE_ELEV,
     DR_PLANE_PITCH,
@@ -55,6 +50,7 @@ enum dataRefsXP_LT {
     // X-Plane 11 only
     DR_XP_ATIS_ENABLED,                 ///< sim/atc/atis_enabled
     DR_VR_ENABLED,                      ///< sim/graphics/VR/enabled
+    DR_RADIO_COM_TX,                    ///< sim/cockpit2/radios/actuators/audio_com_selection
     // LiveTraffic
     DR_LT_AIRCRAFTS_DISPLAYED,          ///< is LiveTraffic active?
     DR_LT_FD_BUF_PERIOD,                ///< LiveTraffic's buffering period
@@ -70,14 +66,77 @@ constexpr dataRefsXP_LT DR_FIRST_LT_DR = DR_LT_AIRCRAFTS_DISPLAYED;
 enum cmdRefsPLA {
     CR_MONITOR_COM1 = 0,                ///< Monitor change of COM1
     CR_MONITOR_COM2,                    ///< Monitor change of COM2
+    CR_SAY_AGAIN_COM1,                  ///< Replay last transmission on COM1
+    CR_SAY_AGAIN_COM2,                  ///< Replay last transmission on COM2
     
     /// always last, number of elements
     CNT_CMDREFS_PLA
 };
 
-/// number of Frequencies to listen to
-constexpr int COM_CNT = 2;
+/// number of COM radios X-Plane provides standard datarefs for
+constexpr int COM_CNT_XP = 2;
+/// maximum number of channels, COM radios plus additional monitor channels
+constexpr int COM_CNT_MAX = 8;
 
+/// dataref name patterns of X-Plane's COM radios, `%d` is the 1-based radio number
+#define DR_XP_RADIO_COM_FREQ        "sim/cockpit2/radios/actuators/com%d_frequency_hz_833"
+#define DR_XP_RADIO_COM_STANDBY     "sim/cockpit2/radios/actuators/com%d_standby_frequency_hz_833"
+#define DR_XP_RADIO_COM_SEL         "sim/cockpit2/radios/actuators/audio_selection_com%d"
+
+/// @brief Defines where a channel takes its frequencies from
+/// @details COM1 and COM2 are bound to X-Plane's radios. Further channels
+///          are defined in the config file, either by a set of datarefs
+///          (e.g. a third COM radio provided by the aircraft) or by a fixed
+///          frequency to monitor. Datarefs are looked up only when the
+///          channel's frequency is first asked for.
+class ComBindingTy
+{
+public:
+    std::string drFrequ;        ///< dataref of the active frequency, empty for a fixed frequency
+    std::string drStandby;      ///< dataref of the stand-by frequency (optional)
+    std::string drSel;          ///< dataref telling if the radio is selected for listening (optional)
+    int fixedFrequ = 0;         ///< fixed frequency of a monitor channel, in the datarefs' unit like 121500
+    bool bActOn = true;         ///< act upon this channel?
+protected:
+    mutable bool bBound = false;            ///< datarefs looked up already?
+    mutable XPLMDataRef adrFrequ   = NULL;  ///< active frequency
+    mutable XPLMDataRef adrStandby = NULL;  ///< stand-by frequency
+    mutable XPLMDataRef adrSel     = NULL;  ///< audio selection
+
+public:
+    /// Undefined channel
+    ComBindingTy () {}
+    /// @brief Binding to one of X-Plane's COM radios
+    /// @param comNr 1-based number of the COM radio
+    ComBindingTy (int comNr);
+    
+    /// Is there any source for a frequency?
+    inline bool IsDefined () const { return fixedFrequ > 0 || !drFrequ.empty(); }
+    /// Active frequency, 0 if not available
+    int GetFrequ () const;
+    /// Stand-by frequency, 0 if not available
+    int GetStandbyFrequ () const;
+    /// Is the radio selected for listening? (`true` if there is no such dataref)
+    bool IsSelected () const;
+    
+    /// @brief Set the definition from a config file entry
+    /// @param s `<fixed frequency | frequency dataref> [<stand-by dataref> [<selection dataref>]]`,
+    ///          `-` skips an optional dataref
+    /// @return Is the channel defined now?
+    bool SetFromCfg (const std::string& s);
+    /// The definition in config file format
+    std::string GetCfgString () const;
+
+protected:
+    /// Lookup the datarefs, if not done yet
+    void Bind () const;
+};
+
+/// An additional audio output the mix is routed to (mixer only)
+struct AudioRouteTy {
+    std::string devId;          ///< VLC audio output device id
+    int gain = 100;             ///< [%] gain applied on this output
+};
 
 class DataRefs
 {
@@ -99,12 +158,13 @@ protected:
     std::string PluginPath;                     ///< path to plugin directory
     std::string DirSeparator;                   ///< directory separation character
     
-    bool bActOnCom[COM_CNT] = {true,true};      ///< which frequency to act upon?
+    std::vector<ComBindingTy> vCom;             ///< channels and which of them to act upon
     bool bRespectAudioSelect = false;           ///< only play VLC stream for selected radio
 #if !(IBM)
     std::string VLCPluginPath;                  ///< Path to VLC plugins
 #endif
     std::string audioDev;                       ///< VLC audio output device id
+    std::vector<AudioRouteTy> audioRoutes;      ///< additional audio outputs (mixer only)
     int iVolume = 100;                          ///< volume VLC play at (0-100)
     bool bMute = false;                         ///< temporarily muted? (not stored in config file)
     bool bDesyncLiveTrafficDelay = true;        ///< audio-desync with LiveTraffic's delay?
@@ -113,6 +173,18 @@ protected:
     bool bPreBufferStandbyFrequ = true;         ///< Pre-buffer stand-by frequency once it has been changed
     bool bAtisPreferLiveATC = true;             ///< if playing a LiveATC-ATIS-stream suppress XP's output (XP11 only)
     int maxRadioDist = 300;                     ///< [nm] max distance a radio can be received
+    bool bRadioHorizon = true;                  ///< limit reach by radio horizon based on altitude?
+    bool bTerrainLOS = false;                   ///< check terrain line of sight to stations?
+    bool bPrefetchFPlan = true;                 ///< prefetch streams for the flight plan's airports?
+    int warmPoolSize = 2;                       ///< max number of muted warm streams, shared by all channels
+    int idleReleaseS = 120;                     ///< [s] idle channels release their buffers after that time
+    bool bAudioMixer = true;                    ///< mix all streams into one OpenAL output instead of one VLC output per stream?
+    int audioBufMaxKB = 8192;                   ///< [KB] size of one stream's audio buffer with the mixer, limits the desync period
+    bool bAudioBufULaw = false;                 ///< store buffered audio as 8 bit mu-law instead of 16 bit PCM?
+    bool bRadioFx = false;                      ///< make mixed streams sound like a radio: bandpass, compression, distance static?
+    int audioDuckPct = 30;                      ///< [%] volume of other channels while the transmit-selected COM receives (mixer only)
+    int replayMin = 5;                          ///< [min] history of received audio kept per channel for "say again" (mixer only), 0 = off
+    bool bPredictNext = true;                   ///< predict the next frequency by flight phase and warm it up?
     
 //MARK: Constructor
 public:
@@ -136,8 +208,10 @@ public:
     inline logLevelTy GetMsgAreaLevel()         { return iMsgAreaLevel; }
 
     // Configuration
-    inline bool ShallActOnCom(int idx) const { return 0<=idx&&idx<COM_CNT ? bActOnCom[idx] : false; }
-    inline void SetActOnCom(int idx, bool bEnable) { if (0<=idx&&idx<COM_CNT) {bActOnCom[idx] = bEnable; MenuUpdateCheckmarks();} }
+    /// Number of channels, at least the COM radios X-Plane provides
+    inline int GetComCnt() const { return (int)vCom.size(); }
+    inline bool ShallActOnCom(int idx) const { return 0<=idx&&idx<GetComCnt() ? vCom[idx].bActOn : false; }
+    inline void SetActOnCom(int idx, bool bEnable) { if (0<=idx&&idx<GetComCnt()) {vCom[idx].bActOn = bEnable; MenuUpdateCheckmarks();} }
     void ToggleActOnCom(int idx) { SetActOnCom(idx,!ShallActOnCom(idx)); }
     inline bool ShallRespectAudioSelect() const { return bRespectAudioSelect; }
     void SetRespectAudioSelect (bool b) { bRespectAudioSelect = b; }
@@ -149,6 +223,12 @@ public:
 
     std::string GetAudioDev() const { return audioDev; }    ///< Audio Device ID
     void SetAudioDev(const std::string& dev) { audioDev = dev; }
+    /// Additional audio outputs the mix is routed to
+    const std::vector<AudioRouteTy>& GetAudioRoutes() const { return audioRoutes; }
+    /// Is the mix routed to this device additionally?
+    bool IsAudioRoute (const std::string& devId) const;
+    /// Add (with full gain) or remove an additional audio output
+    void ToggleAudioRoute (const std::string& devId);
     int GetVolume() const { return iVolume; }       ///< Volume
     void SetVolume(int iNewVolume);                 ///< sets new volume, also applies it to current playback
     bool IsMuted() const { return bMute; }          ///< Currently muted?
@@ -175,12 +255,58 @@ public:
     inline void SetPreBufferSTandbyFrequ (bool b) { bPreBufferStandbyFrequ = b; }
     
     // specific access
-    inline int   GetComFreq(int idx) const  { return 0<=idx&&idx<COM_CNT ? XPLMGetDatai(adrXP[int(DR_XP_RADIO_COM1_FREQ)+idx]) : 0; }
-    inline int   GetComStandbyFreq(int idx) const  { return 0<=idx&&idx<COM_CNT ? XPLMGetDatai(adrXP[int(DR_XP_RADIO_COM1_STANDBY_FREQ)+idx]) : 0; }
-    inline int   IsComSel(int idx) const    { return 0<=idx&&idx<COM_CNT ? XPLMGetDatai(adrXP[int(DR_XP_RADIO_COM1_SEL)+idx]) : 0; }
+    inline int   GetComFreq(int idx) const  { return 0<=idx&&idx<GetComCnt() ? vCom[idx].GetFrequ() : 0; }
+    inline int   GetComStandbyFreq(int idx) const  { return 0<=idx&&idx<GetComCnt() ? vCom[idx].GetStandbyFrequ() : 0; }
+    inline int   IsComSel(int idx) const    { return 0<=idx&&idx<GetComCnt() ? vCom[idx].IsSelected() : 0; }
+    /// Is this X-Plane's COM radio the mic is selected to?
+    bool IsComTx(int idx) const;
     positionTy GetUsersPlanePos() const;
+    double GetPlaneElev_m() const   { return XPLMGetDatad(adrXP[DR_PLANE_ELEV]); }
+    double GetPlaneTAS_kn() const   { return XPLMGetDataf(adrXP[DR_PLANE_TRUE_AIRSPEED]) * KT_per_M_per_S; }
+    bool   IsPlaneOnGround() const  { return XPLMGetDatai(adrXP[DR_PLANE_ONGRND]) != 0; }
     int GetMaxRadioDist () const { return maxRadioDist; }
     void SetMaxRadioDist (int i) { maxRadioDist = i; }
+    /// Limit radio reach by radio horizon?
+    bool ShallUseRadioHorizon () const { return bRadioHorizon; }
+    void SetUseRadioHorizon (bool b) { bRadioHorizon = b; }
+    /// Check terrain line of sight to stations?
+    bool ShallCheckTerrainLOS () const { return bTerrainLOS; }
+    void SetCheckTerrainLOS (bool b) { bTerrainLOS = b; }
+    /// Prefetch streams for the flight plan's airports?
+    bool ShallPrefetchFlightPlan () const { return bPrefetchFPlan; }
+    void SetPrefetchFlightPlan (bool b) { bPrefetchFPlan = b; }
+    /// Max number of muted warm streams kept for quick handover, shared by all channels
+    int GetWarmPoolSize () const { return warmPoolSize; }
+    void SetWarmPoolSize (int i) { warmPoolSize = std::clamp(i, 0, COM_CNT_MAX); }
+    /// [s] Idle channels release their media players and buffers after that time
+    int GetIdleReleaseS () const { return idleReleaseS; }
+    void SetIdleReleaseS (int i) { idleReleaseS = std::clamp(i, 10, 3600); }
+    /// Mix all streams into one OpenAL output? (Takes effect with the next VLC initialization)
+    bool ShallUseAudioMixer () const { return bAudioMixer; }
+    void SetUseAudioMixer (bool b) { bAudioMixer = b; }
+    /// [KB] Max size of one stream's audio desync buffer, limits the desync period with the mixer
+    int GetAudioBufMaxKB () const { return audioBufMaxKB; }
+    void SetAudioBufMaxKB (int i) { audioBufMaxKB = std::clamp(i, 256, 65536); }
+    /// Store buffered audio as 8 bit mu-law, halving memory at slightly lower quality?
+    bool ShallCompressAudioBuf () const { return bAudioBufULaw; }
+    void SetCompressAudioBuf (bool b) { bAudioBufULaw = b; }
+    /// Make mixed streams sound like a radio: bandpass, compression, and static increasing with distance?
+    bool ShallApplyRadioFx () const { return bRadioFx; }
+    void SetApplyRadioFx (bool b) { bRadioFx = b; }
+    /// [%] Volume of other channels while the COM selected for transmit receives, 100 = no ducking
+    int GetAudioDuckPct () const { return audioDuckPct; }
+    void SetAudioDuckPct (int i) { audioDuckPct = std::clamp(i, 0, 100); }
+    /// [min] History of received audio kept per channel for "say again", 0 = off (takes effect with the next VLC initialization)
+    int GetReplayMin () const { return replayMin; }
+    void SetReplayMin (int i) { replayMin = std::clamp(i, 0, 60); }
+    /// Predict the next frequency by flight phase and warm it up?
+    bool ShallPredictNextFrequ () const { return bPredictNext; }
+    void SetPredictNextFrequ (bool b) { bPredictNext = b; }
+    /// @brief Distance [nm] up to which a station can be received from the plane
+    /// @param planePos Plane's position, altitude is taken from DR_PLANE_ELEV
+    /// @param stationPos Station's position, altitude is the airport's elevation
+    double GetRadioReach_nm (const positionTy& planePos,
+                             const positionTy& stationPos) const;
     
     inline bool  IsVREnabled() const            { return
 #ifdef DEBUG
@@ -0,0 +1,111 @@
+//
+//  PLAAirports.h
+//  PlayLiveATC
+//
+// Compact in-memory table of all airports in X-Plane's nav database,
+// loaded once at startup in small per-frame time slices
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAAirports_h
+#define PLAAirports_h
+
+#define MSG_AP_TABLE_LOADED "Airport table loaded: %lu airports in %d frames, %lldus total, max slice %lldus"
+
+/// per-frame time budget for loading airports from the nav database
+constexpr std::chrono::microseconds AP_TABLE_FRAME_BUDGET(1000);
+
+/// @brief Sorted structure-of-arrays table of airport positions
+/// @details At startup the nav database is walked once for all airports,
+///          a few hundred per frame, from a flight loop callback.
+///          Once completely loaded the table is immutable, so lookups
+///          can be made from any thread without locking; they are
+///          binary searches on the packed ICAO ids.
+///          Until then lookups are queued and answered by `XPLMFindNavAid`
+///          from the main thread's flight loop callback.
+class AirportTableTy
+{
+protected:
+    // the table, sorted by vIcao, all vectors have the same size
+    std::vector<uint64_t> vIcao;    ///< packed airport ids, see PackIcao()
+    std::vector<float> vLat;        ///< latitude
+    std::vector<float> vLon;        ///< longitude
+    std::vector<float> vElev_m;     ///< elevation in meters
+    
+    /// Table is complete and won't change any longer
+    std::atomic<bool> bLoaded{false};
+    
+    // lookups while not yet loaded, answered by DoWork()
+    std::set<std::string> setPending;           ///< ids still to look up
+    std::map<std::string,positionTy> mapFallback;   ///< ids looked up, NAN position if not found
+    mutable std::mutex mtxFallback;             ///< guards `setPending` and `mapFallback`
+    
+    // loading state
+    XPLMNavRef navNext = XPLM_NAV_NOT_FOUND;    ///< next nav aid to read
+    bool bLoading = false;                      ///< walk has been started
+    int nFrames = 0;                            ///< number of frames worked on loading
+    std::chrono::microseconds tTotal{0};        ///< total time spent loading
+    std::chrono::microseconds tMaxSlice{0};     ///< maximum time spent per frame
+
+public:
+    /// @brief Reads airports from the nav database till `budget` is used up
+    /// @warning Must be called from X-Plane's main thread
+    /// @return Is there more work pending?
+    bool DoWork (std::chrono::microseconds budget);
+    
+    /// Is the table completely loaded?
+    bool IsLoaded () const { return bLoaded; }
+    
+    /// @brief Return an airport's position incl. elevation
+    /// @details Can be called from any thread. While the table isn't loaded yet
+    ///          the lookup is queued for the main thread and `pbPending` set.
+    /// @param icao Airport id
+    /// @param[out] pbPending If given, receives if the lookup is still pending
+    /// @return Position, or a position with NAN values if not (yet) found
+    positionTy Find (const std::string& icao, bool* pbPending = nullptr);
+    
+    /// Removes all entries, a new load is started with the next call to DoWork()
+    void Clear ();
+    
+    /// @brief Packs up to 8 characters of an id into an integer,
+    ///        which sorts like the id itself
+    /// @return Packed id, 0 if `icao` is empty or too long
+    static uint64_t PackIcao (const char* icao);
+    
+protected:
+    /// Look up queued ids with `XPLMFindNavAid`, main thread only
+    void FindPending ();
+    /// Sort the collected entries and remove duplicates
+    void FinishLoading ();
+};
+
+/// The global airport table
+extern AirportTableTy gAirports;
+
+/// Start loading the airport table from a flight loop callback
+void AirportsStart ();
+/// Stop loading and clear the airport table
+void AirportsStop ();
+
+#endif /* PLAAirports_h */
@@ -0,0 +1,415 @@
+//
+//  PLAAudio.h
+//  PlayLiveATC
+//
+// In-process audio mixer: VLC delivers decoded audio via callbacks
+// into feeds, which voices read from and which are mixed into one OpenAL source
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAAudio_h
+#define PLAAudio_h
+
+#define DBG_AUDIO_OPEN      "Audio mixer: Opened OpenAL device '%s'"
+#define ERR_AUDIO_OPEN      "Audio mixer: Could not open OpenAL device '%s', streams use VLC's audio output instead"
+#define MSG_AUDIO_STATS     "Audio mixer: %lu buffers mixed, %lu underruns, %lu samples dropped, %lu buffers skipped by additional outputs"
+#define MSG_AUDIO_FX_STATS  "Audio mixer: Radio effect processed %.0fs of audio in %.1fms, that is %.4f%% of one core per stream"
+#define DBG_AUDIO_ROUTE     "Audio mixer: Routing the mix additionally to '%s' at %d%%"
+#define WARN_AUDIO_ROUTE    "Audio mixer: No OpenAL device found for additional output '%s', or it is in use already"
+#define DBG_AUDIO_FEED_DROP "Audio feed: %lu samples dropped for lack of room"
+#define WARN_AUDIO_BUF_MAX  "Audio desync of %lds exceeds the audio buffer limit of %dKB, desync limited to %lds"
+
+constexpr int       AUDIO_RATE          = 22050;    ///< [Hz] sample rate VLC decodes to and OpenAL plays
+constexpr const char* AUDIO_FORMAT      = "FL32";   ///< VLC's sample format: 32 bit float, mono
+constexpr int       AUDIO_BUF_MS        = 50;       ///< [ms] length of one OpenAL buffer
+constexpr int       AUDIO_BUF_FRAMES    = AUDIO_RATE * AUDIO_BUF_MS / 1000; ///< samples per OpenAL buffer
+constexpr int       AUDIO_AL_BUFFERS    = 8;        ///< number of OpenAL buffers queued, covers frame time hiccups
+constexpr int       AUDIO_RING_S        = 4;        ///< [s] ring buffer size on top of the desync period, also the minimum size
+constexpr size_t    AUDIO_CHUNKS        = 1024;     ///< max number of chunks in a feed's ring, contiguous chunks are merged
+constexpr int64_t   AUDIO_PTS_TOL_US    = 2000;     ///< [us] chunks this close to contiguous are merged
+constexpr int64_t   AUDIO_MAX_LATE_US   = 500000;   ///< [us] audio later than this is dropped to catch up, e.g. after an underrun
+constexpr int64_t   AUDIO_RETARGET_TOL_US = 20000;  ///< [us] audio later than this is skipped where it is quiet, e.g. after the desync period was shortened
+constexpr int64_t   AUDIO_RETARGET_STEP_US = AUDIO_BUF_MS * 1000;  ///< [us] max change of the applied desync period per buffer while retargeting
+constexpr int       AUDIO_RAMP_MS       = 20;       ///< [ms] gain changes from 0 to 1 (or back) ramp over that time
+constexpr float     AUDIO_DUCK_THR      = 0.02f;    ///< signal level of a voice considered as someone talking, which ducks others
+constexpr float     AUDIO_DUCK_RELEASE_MS = 600.0f; ///< [ms] release of a voice's signal level, bridges short pauses in speech
+
+constexpr float     AUDIO_FX_LOW_HZ     = 300.0f;   ///< [Hz] radio effect: lower edge of the voice band
+constexpr float     AUDIO_FX_HIGH_HZ    = 3400.0f;  ///< [Hz] radio effect: upper edge of the voice band
+constexpr unsigned  AUDIO_FX_BLOCK      = 32;       ///< radio effect: samples per block sharing one compressor gain
+constexpr float     AUDIO_FX_COMP_THR   = 0.1f;     ///< radio effect: compressor threshold (-20 dBFS)
+constexpr float     AUDIO_FX_COMP_RATIO = 3.0f;     ///< radio effect: compressor ratio
+constexpr float     AUDIO_FX_COMP_MAKEUP = 2.0f;    ///< radio effect: make-up gain after compression
+constexpr float     AUDIO_FX_ATTACK_MS  = 5.0f;     ///< [ms] radio effect: compressor/squelch attack time
+constexpr float     AUDIO_FX_RELEASE_MS = 150.0f;   ///< [ms] radio effect: compressor/squelch release time
+constexpr float     AUDIO_FX_SQUELCH    = 0.01f;    ///< radio effect: input level opening the squelch
+constexpr float     AUDIO_FX_STATIC_MAX = 0.2f;     ///< radio effect: static level at the edge of radio reach
+
+/// A chunk of contiguous samples, as delivered by one or more calls of VLC's play callback
+struct AudioChunkTy {
+    std::atomic<int64_t> pts{0};    ///< [us] libVLC clock time when to play the first sample
+    std::atomic<size_t> start{0};   ///< index of the first sample
+    std::atomic<size_t> count{0};   ///< number of samples, grows while VLC delivers contiguous audio
+};
+
+/// Encoding of samples in a feed's ring
+enum AudioEncTy : uint8_t {
+    AUDIO_ENC_PCM16 = 0,        ///< 16 bit linear PCM, 2 bytes per sample
+    AUDIO_ENC_ULAW,             ///< 8 bit G.711 mu-law, 1 byte per sample
+};
+
+/// G.711 mu-law encoding of a 16 bit sample
+uint8_t ULawEncode (int16_t pcm);
+/// Decoding table for mu-law, straight to float
+const std::array<float,256>& ULawTable ();
+
+class AudioVoiceTy;
+class ReplayRingTy;
+
+/// One biquad filter stage, transposed direct form II
+struct AudioBiquadTy {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;    ///< normalized coefficients
+    float z1 = 0.0f, z2 = 0.0f;                                     ///< state
+    
+    /// Butterworth lowpass at `hz`
+    void SetLowpass (float hz);
+    /// Butterworth highpass at `hz`
+    void SetHighpass (float hz);
+    /// Filter `n` samples in place
+    void Process (float* buf, unsigned n);
+};
+
+/// @brief Radio effect applied to one voice's audio
+/// @details Static (only while the squelch is open, i.e. while someone talks)
+///          is added, then everything is limited to the voice band and
+///          compressed like a radio's AGC does.
+///          The work is done on blocks of `AUDIO_FX_BLOCK` samples:
+///          Level detection, gain ramps, and noise mixing are plain loops
+///          over float arrays, which the compiler vectorizes. As a serial
+///          maximum or random sequence wouldn't vectorize without `-ffast-math`,
+///          level detection is a pairwise maximum over the block and
+///          noise comes from one generator per sample of the block.
+///          Only the filter recursion is inherently sample by sample.
+///          (Verify with `-O3 -fopt-info-vec` on PLAAudio.cpp. The actual cost
+///          per stream is logged as `MSG_AUDIO_FX_STATS` when the mixer stops.)
+class AudioRadioFxTy
+{
+protected:
+    AudioBiquadTy hp, lp;               ///< voice band filters
+    float env = 0.0f;                   ///< compressor's envelope
+    float compGain = 1.0f;              ///< compressor's gain applied at the end of the last block
+    float sqlLevel = 0.0f;              ///< squelch: envelope of the input level
+    float sqlGain = 0.0f;               ///< squelch: static gain applied at the end of the last block
+    std::array<uint32_t,AUDIO_FX_BLOCK> rnd;    ///< state of the noise generators, one per sample of a block
+    std::atomic<float> staticLvl{0.0f}; ///< static level, set by the channel's executor
+    std::array<float,AUDIO_FX_BLOCK> noise; ///< noise of the current block
+    
+public:
+    /// Sets up the voice band filters
+    AudioRadioFxTy ();
+    /// Set the static level, 0.0 .. `AUDIO_FX_STATIC_MAX`
+    void SetStatic (float lvl) { staticLvl = lvl; }
+    /// Process `n` samples in place
+    void Process (float* buf, unsigned n);
+protected:
+    /// Process one block of up to `AUDIO_FX_BLOCK` samples in place
+    void ProcessBlock (float* buf, unsigned n);
+    /// Peak absolute value of up to `AUDIO_FX_BLOCK` samples
+    static float Peak (const float* buf, unsigned n);
+};
+
+/// @brief One media player's decoded audio, read by one or more voices
+/// @details VLC's audio thread writes, voices read at their own cursor,
+///          both lock-free. The writer only takes a short lock to learn
+///          how far the slowest voice is, so that nothing is overwritten
+///          that is still to be played.
+///          The ring is encoded compactly and capped in size, so the
+///          memory a stream needs for desync is bounded and known.
+class AudioFeedTy
+{
+protected:
+    const AudioEncTy enc;               ///< encoding of samples in the ring
+    std::vector<uint8_t> ring;          ///< encoded sample ring buffer
+    size_t cap = 0;                     ///< ring's capacity in samples
+    std::atomic<size_t> tail{0};        ///< number of samples written so far
+    std::array<AudioChunkTy,AUDIO_CHUNKS> chunks;   ///< chunk `i` is stored at `i % AUDIO_CHUNKS`
+    std::atomic<size_t> nChunks{0};     ///< number of chunks started so far
+    std::atomic<unsigned> flushGen{0};  ///< incremented when VLC asks to discard pending samples
+    std::vector<AudioVoiceTy*> readers; ///< voices reading from this feed
+    std::mutex mtxReaders;              ///< guards `readers`
+    unsigned long cntDropped = 0;       ///< VLC's audio thread: samples dropped for lack of room
+    
+public:
+    /// @brief Constructor allocates the ring
+    /// @param desyncSecs [s] audio desync period the ring shall hold on top of `AUDIO_RING_S`,
+    ///                   limited to what `maxBytes` allows
+    /// @param e Encoding of samples in the ring
+    /// @param maxBytes Upper limit of the ring's size, may limit the possible desync period
+    AudioFeedTy (long desyncSecs, AudioEncTy e, size_t maxBytes);
+    /// Destructor logs dropped samples
+    ~AudioFeedTy ();
+    
+    /// [us] Longest desync period a voice can have on this feed
+    int64_t GetMaxDelayUs () const;
+    /// [bytes] Memory held by the ring
+    unsigned long GetBytes () const { return (unsigned long)ring.size(); }
+    /// Ring's capacity in samples
+    size_t GetCapacity () const { return cap; }
+    
+    /// @brief Have VLC deliver the player's audio to this feed
+    /// @note Must be done before playback starts. The feed must outlive the player's playback.
+    void Attach (VLC::MediaPlayer& mp);
+    
+    /// VLC's audio thread: store samples
+    void Write (const float* samples, unsigned count, int64_t pts);
+    
+protected:
+    friend AudioVoiceTy;
+    /// Voice starts reading at the current end of the feed
+    void AddReader (AudioVoiceTy* v);
+    /// Voice stops reading
+    void RemoveReader (AudioVoiceTy* v);
+    /// Store one sample encoded at ring position `i`
+    void Encode (size_t i, float f);
+    /// Decode the sample at ring position `i`
+    float Decode (size_t i) const;
+    
+    /// VLC callback: play samples
+    static void cbPlay (void* data, const void* samples, unsigned count, int64_t pts);
+    /// VLC callback: discard pending samples
+    static void cbFlush (void* data, int64_t pts);
+};
+
+/// Shared pointer to a feed, shared by media player owners, voices, and reaper
+typedef std::shared_ptr<AudioFeedTy> AudioFeedPtrTy;
+
+/// @brief One consumer of a feed as mixed by the mixer
+/// @details Each voice has its own read cursor, audio desync, and gain.
+///          It implements the audio desync itself: VLC delivers audio
+///          about when it is to be played, the feed keeps it, and the voice
+///          has the mixer play it exactly `delayUs` later.
+///          Gain changes are ramped sample by sample. A voice can duck all
+///          others while it carries a signal.
+///          The desync period can change any time while playing: The applied
+///          period moves toward it in steps of `AUDIO_RETARGET_STEP_US`, only
+///          in pauses. A longer one inserts silence, a shorter one skips
+///          quiet samples, and takes the next step only once the voice has
+///          caught up. Speech is never cut. The stream just continues.
+class AudioVoiceTy
+{
+protected:
+    friend AudioFeedTy;
+    const AudioFeedPtrTy pFeed;         ///< the feed we read from
+    std::atomic<size_t> head{0};        ///< next sample to read, written by the mixer only
+    std::atomic<size_t> chunk{0};       ///< chunk `head` is in, written by the mixer only
+    unsigned flushGen = 0;              ///< mixer: last flush of the feed seen
+    std::atomic<int64_t> delayUs{0};    ///< [us] audio desync: play that much later than VLC's pts
+    int64_t playDelayUs = 0;            ///< [us] mixer: audio desync applied, follows `delayUs` step by step in pauses
+    int64_t lateUs = -1;                ///< [us] mixer: how late the last buffer started playing, -1 if nothing was played
+    std::atomic<float> gain{1.0f};      ///< target gain, 0 for mute
+    float curGain = 0.0f;               ///< mixer: gain applied at the end of the last buffer, ramps toward the target
+    std::atomic<bool> bDuckOthers{false};   ///< duck all other voices while this one carries a signal?
+    float level = 0.0f;                 ///< mixer: signal level, peak with slow release
+    bool bDuckLatched = false;          ///< mixer: `bDuckOthers` as valid for the current buffer
+    std::atomic<bool> bAudible{false};  ///< has the mixer played anything yet, i.e. is desync done?
+    std::atomic<unsigned long> cntDropped{0};   ///< statistics: samples dropped as late
+    std::atomic<bool> bFx{false};       ///< apply the radio effect?
+    AudioRadioFxTy fx;                  ///< radio effect, used by the mixer only
+    std::vector<float> buf;             ///< mixer: the voice's samples before effect and gain
+    std::atomic<ReplayRingTy*> pRec{nullptr};   ///< history the voice's audio is recorded into, if any
+    std::atomic<unsigned long> cntFxSamples{0}; ///< statistics: samples processed by the radio effect
+    std::atomic<uint64_t> fxNs{0};      ///< statistics: [ns] time spent in the radio effect
+    
+public:
+    /// Constructor starts reading at the feed's current end
+    AudioVoiceTy (const AudioFeedPtrTy& feed);
+    /// Destructor stops reading
+    ~AudioVoiceTy ();
+    
+    /// Set the target gain, 0.0 .. 1.0, which the mixer ramps to
+    void SetGain (float g) { gain = g; }
+    /// Shall this voice duck all others while it carries a signal?
+    void SetDuckOthers (bool b) { bDuckOthers = b; }
+    /// Mixer: Take over `bDuckOthers` for the current buffer, does this voice duck all others?
+    bool LatchDuckOthers () { return bDuckLatched = bDuckOthers; }
+    /// Mixer: Does this voice duck all others in the current buffer?
+    bool IsDuckLatched () const { return bDuckLatched; }
+    /// Record the voice's audio as played into this history, `nullptr` to stop recording
+    void SetRecorder (ReplayRingTy* r) { pRec = r; }
+    /// Mixer: Is there currently a signal, i.e. someone talking?
+    bool HasSignal () const { return level > AUDIO_DUCK_THR; }
+    /// Number of samples dropped as late
+    unsigned long GetDropped () const { return cntDropped; }
+    /// @brief Switch the radio effect on or off
+    /// @param bOn Apply the radio effect?
+    /// @param staticLvl Level of static, 0.0 .. `AUDIO_FX_STATIC_MAX`, increasing with distance
+    void SetRadioFx (bool bOn, float staticLvl);
+    /// Statistics: samples processed by the radio effect
+    unsigned long GetFxSamples () const { return cntFxSamples; }
+    /// Statistics: [ns] time spent in the radio effect
+    uint64_t GetFxNs () const { return fxNs; }
+    
+    /// @brief Set the audio desync period, also while playing
+    /// @return [us] Desync period actually set, limited by the feed's size
+    int64_t SetDelay (int64_t us);
+    /// [us] Audio desync period
+    int64_t GetDelay () const { return delayUs; }
+    /// [us] Audio buffered for this voice, i.e. its real fill level
+    int64_t GetBufferedUs () const;
+    /// [us] Time till the first sample will be played, 0 if already audible
+    int64_t GetDesyncRemainUs () const;
+    
+    /// @brief Mixer: add samples due by `playTime` to `acc`
+    /// @param acc Accumulation buffer
+    /// @param n Number of samples wanted
+    /// @param playTime [us] libVLC clock time when `acc[0]` will be played
+    /// @param duck Factor on the target gain as others are talking, 1.0 if not ducked
+    /// @return Number of samples of `acc` covered, including silence before the first due sample
+    unsigned Mix (float* acc, unsigned n, int64_t playTime, float duck);
+};
+
+/// Shared pointer to a voice, shared by stream and mixer
+typedef std::shared_ptr<AudioVoiceTy> AudioVoicePtrTy;
+
+/// @brief One OpenAL output device playing the mix
+/// @details X-Plane uses OpenAL itself. To stay out of its way each output
+///          works with its own OpenAL context, which is made current only
+///          while pumping and then restored.
+class AudioOutputTy
+{
+protected:
+    ALCdevice* pDev = nullptr;          ///< OpenAL device
+    ALCcontext* pCtx = nullptr;         ///< our OpenAL context
+    ALuint src = 0;                     ///< the one source playing the mix
+    ALuint bufs[AUDIO_AL_BUFFERS];      ///< buffers cycling through the source
+    std::vector<int16_t> pcm;           ///< buffer for OpenAL
+    std::vector<float> pend;            ///< additional outputs: ring of mixed buffers waiting for a free OpenAL buffer
+    unsigned pendHead = 0;              ///< first pending buffer in `pend`
+    unsigned pendCnt = 0;               ///< number of pending buffers
+    
+public:
+    std::string vlcDevId;               ///< VLC device id the output was selected by
+    std::string alDevName;              ///< name of the OpenAL device opened, empty for default
+    float gain = 1.0f;                  ///< gain applied on this output
+    unsigned long cntUnderrun = 0;      ///< number of times the source ran dry
+    unsigned long cntSkipped = 0;       ///< additional outputs: mixed buffers skipped as the device plays slower
+    
+public:
+    /// Closed output
+    AudioOutputTy () {}
+    /// Owns OpenAL objects, not to be copied
+    AudioOutputTy (const AudioOutputTy&) = delete;
+    /// Closes the device
+    ~AudioOutputTy () { Close(); }
+    /// @brief Open the device, create context, source, and buffers, and start playing silence
+    /// @param dev Name of the OpenAL device, empty for the default device
+    bool Open (const std::string& dev);
+    /// Close the device
+    void Close ();
+    /// Is the device open?
+    bool IsOpen () const { return pCtx != nullptr; }
+    /// Make our context current
+    void MakeCurrent () const { alcMakeContextCurrent(pCtx); }
+    /// Number of buffers played and waiting to be refilled, expects our context current
+    int GetProcessed () const;
+    /// Refill one processed buffer with the mix, `nullptr` for silence, expects our context current
+    void Refill (const float* mix);
+    /// Restart the source if it ran dry, expects our context current
+    void KeepPlaying ();
+    
+    /// Additional outputs: keep a mixed buffer till there is room
+    void PushPending (const float* mix);
+    /// Additional outputs: oldest pending buffer, `nullptr` if none, valid till the next push
+    const float* PopPending ();
+};
+
+/// @brief Mixes all voices and plays the mix on one or more outputs
+/// @details Pump() is called every frame from a flight loop callback; with
+///          `AUDIO_AL_BUFFERS` of `AUDIO_BUF_MS` queued that easily covers
+///          the frame time. The primary output's pace drives mixing.
+///          Additional outputs (routes) get a copy of the very same mix with
+///          their own gain, so an additional output costs no extra network
+///          stream or decoder, just the copy.
+class AudioMixerTy
+{
+protected:
+    AudioOutputTy out;                  ///< primary output
+    std::list<AudioOutputTy> routes;    ///< additional outputs
+    std::vector<AudioRouteTy> cfgRoutes;    ///< additional outputs as configured
+    std::atomic<bool> bActive{false};   ///< mixer running?
+    
+    std::vector<AudioVoicePtrTy> voices;    ///< voices being mixed
+    std::mutex mtx;                     ///< guards `voices`
+    
+    std::vector<float> acc;             ///< accumulation buffer
+    std::atomic<float> duckGain{1.0f};  ///< factor on other voices' gain while a ducking voice carries a signal
+    
+    // Statistics
+    unsigned long cntMixed = 0;         ///< buffers mixed
+    unsigned long cntDropped = 0;       ///< samples dropped by removed voices
+    unsigned long cntFxSamples = 0;     ///< samples processed by the radio effect of removed voices
+    uint64_t fxNs = 0;                  ///< [ns] time spent in the radio effect of removed voices
+    
+public:
+    /// @brief Open the primary OpenAL device and start playing
+    /// @param dev Name of the OpenAL device, empty for the default device
+    bool Start (const std::string& dev);
+    /// Stop playing, close all devices, drop all voices
+    void Stop ();
+    /// Is the mixer running? Otherwise VLC plays through its own audio output
+    bool IsActive () const { return bActive; }
+    /// @brief Switch the primary output to another device
+    /// @param vlcDevId VLC audio device id as selected in the menu, mapped to an OpenAL device by description
+    void SetDevice (const std::string& vlcDevId);
+    /// @brief Set the additional outputs, opens and closes devices as needed
+    /// @param r Additional outputs by VLC audio device id, a device already in use is skipped
+    void SetRoutes (const std::vector<AudioRouteTy>& r);
+    /// Set the factor on other voices' gain while a ducking voice carries a signal, 1.0 for no ducking
+    void SetDuckGain (float g) { duckGain = std::clamp(g, 0.0f, 1.0f); }
+    
+    /// Add a voice to the mix
+    void Add (const AudioVoicePtrTy& v);
+    /// Remove a voice from the mix
+    void Remove (const AudioVoicePtrTy& v);
+    
+    /// Refill processed OpenAL buffers of all outputs, called every frame from the flight loop
+    void Pump ();
+    
+    /// List of available OpenAL output devices
+    static std::vector<std::string> EnumDevices ();
+    /// @brief Map a VLC audio device id to an OpenAL device name by the device's description
+    /// @return OpenAL device name, empty if not found
+    static std::string MapDevice (const std::string& vlcDevId);
+
+protected:
+    /// Open/close additional outputs as configured
+    void ApplyRoutes ();
+    /// Mix all voices into `acc`
+    void MixBuffer (int64_t playTime);
+};
+
+/// The global audio mixer
+extern AudioMixerTy gMixer;
+
+#endif /* PLAAudio_h */
@@ -34,6 +34,7 @@
 #define LIVE_ATC_BASE       "https://" LIVE_ATC_DOMAIN
 #define LIVE_ATC_URL        LIVE_ATC_BASE "/search/f.php?freq=%s"
 #define LIVE_ATC_PLS        ".pls"
+#define LIVE_ATC_SECTION    "<tr><td><strong>ICAO:"
 
 #define ENV_VLC_PLUGIN_PATH "VLC_PLUGIN_PATH"
 
@@ -41,11 +42,13 @@
 #define MSG_COM_IS_NOW      "COM%d is now %s, tuning to '%s'"
 #define MSG_COM_IS_NOW_IN   "COM%d is now %s, tuning to '%s' with %lds delay"
 #define MSG_STBY_IS_NOW_IN  "COM%d stand-by is now %s, pre-buffering '%s' with %lds delay"
+#define MSG_COM_IS_WARM     "COM%d is now %s, switching to warm stream '%s'"
 #define MSG_COM_COUNTDOWN   "COM%d: %ds till '%s' starts"
 #define MSG_AP_CHANGE       "COM%d: Tuning to '%s' as this is closest now"
 #define MSG_AP_OUT_OF_REACH "COM%d: '%s' now out of reach"
 #define MSG_AP_STDBY_CHANGE "COM%d stand-by: Tuning to '%s' as this is closest now"
 #define MSG_AP_STDBY_OUT_OF_REACH "COM%d stand-by: '%s' now out of reach"
+#define WARN_STREAM_FAILED  "COM%d: '%s' failed or ended, restarting"
 #define DBG_QUERY_URL       "Sending query %s"
 #define WARN_RE_ICAO        "Could not find %s in LiveATC reply"
 #define DBG_STREAM_NOT_UP   "Stream %s skipped as it is not UP but '%s'"
@@ -54,17 +57,47 @@
 #define DBG_AP_NOT_FOUND    "Could not find airport %s in X-Plane's nav database"
 #define DBG_AP_CLOSEST      "Closest airport is %s (%.1fnm)"
 #define DBG_AP_NO_CLOSEST   "No airport found within %.1fnm"
+#define DBG_AP_NOT_IN_REACH "Airport %s (%.1fnm) beyond radio reach of %.1fnm"
+#define DBG_AP_LOS_BLOCKED  "Airport %s (%.1fnm) masked by terrain"
 #define DBG_STREAM_STOP     "Stopping playback of '%s' (%s)"
 #define DBG_VLC_OUT_DEV     "COM%d: Set output device to %s, is now reported to be %s"
 #define DBG_VLC_VOLUME      "Setting volume to %d%%"
 #define DBG_VLC_MUTE        "All Muting"
 #define DBG_VLC_UNMUTE      "All Unmuting"
+#define MSG_REPLAY_NONE     "COM%d: Nothing to say again"
+#define MSG_REPLAY_START    "COM%d: Say again, replaying %.0fs received %lds ago"
+#define DBG_DESYNC_RETARGET "COM%d: Retargeting audio desync of '%s' from %lds to %lds"
+#define DBG_STREAM_SHARED   "COM%d: Sharing the media player already playing '%s' (%s)"
+#define DBG_WARM_KEEP       "COM%d: Keeping '%s' (%s) warm"
+#define DBG_WARM_START      "COM%d: Warming up %s"
+#define DBG_WARM_EVICT      "COM%d: Stopping warm stream '%s' (%s)"
+#define DBG_AP_SWITCH_HOLD  "COM%d: Staying with '%s' (%.1fnm) over '%s' (%.1fnm): %s"
+#define MSG_CHN_RESOURCES   "Channels: %d configured, %d created, %d media players, %luKB buffers, %lu times shared a player, %d streams running, %d warm streams, %d worker threads"
+#define MSG_CHN_IDLE        "COM%d: Idle for %ds, releasing resources: %d media players and %luKB buffers before, %d and %luKB after"
+#define MSG_PREDICT_STATS   "COM%d: %d frequencies predicted, %d of them tuned (%.0f%%), %.1f min of warm streaming for predictions"
+#define DBG_PREDICT_NEXT    "COM%d: Predicting %d.%03d (%s, %.0f%%) next, flight phase %s"
+#define DBG_STOP_SLOW       "Stopping a stream took %.1fms, more than the %dms aimed at"
+#define MSG_REAPER_STATS    "Stream teardown: %lu media players reaped, taking up to %.0fms each in the background; stop paths took up to %.2fms (avg %.3fms), %lu times more than %dms"
+#define MSG_AP_SWITCH_STATS "COM%d: %d airport switches (%d suppressed), %d stream restarts in %.2fh, that is %.1f switches/h, %.1f restarts/h"
 
 /// 100 KB of network response storage initially
 constexpr std::string::size_type READ_BUF_INIT_SIZE = 100 * 1024;
 constexpr long ADD_COUNTDOWN_DELAY_S = 1;   ///< [s] countdown delay (for query, buffering...)
 
+// Airport switching policy, see COMChannel::ShallSwitchAirport()
+constexpr double AP_SWITCH_HYST_NM = 3.0;   ///< [nm] another airport must be at least that much closer for a switch
+constexpr double AP_SWITCH_HYST_REL = 0.10; ///< [-] ...and also at least 10% closer than the current one
+constexpr int AP_SWITCH_MIN_DWELL_S = 120;  ///< [s] minimum time to stay with a selected airport stream
+constexpr long AP_SWITCH_RESTART_S = 5;     ///< [s] fixed restart penalty: query, connect, buffer
+constexpr double AP_SWITCH_NM_PER_S = 0.5;  ///< [nm/s] distance gain needed per second of audio lost by a restart
+
+// Warm stream pool, see COMChannel::RetireStream()
+constexpr int WARM_MAX_AGE_S = 600;         ///< [s] warm streams not used for that long are stopped
+constexpr int WARM_START_TIMEOUT_S = 60;    ///< [s] warm streams not buffering after that long are dropped
+constexpr double WARM_LIKELY_STANDBY = 0.5; ///< [-] likelihood that a dialed stand-by frequency is tuned next
+
 #define ERR_VLC_INIT        "Could not init VLC: %s"
+#define MSG_VLC_INIT_DONE   "VLC initialized in %.1fs, %d audio output devices found"
 #define ERR_GET_LIVE_ATC    "Could not "
 #define ERR_VLC_PLAY        "Could not play '%s': %s"
 
@@ -92,6 +125,7 @@ struct LiveATCDataTy {
     std::string streamName;     ///< Stream name, like "Tower"
     std::string playUrl;        ///< URL to play according to LiveATC
     int nFacilities = 0;        ///< Number of facilities table rows (the lower the better!)
+    bool bInReach = true;       ///< In reach when last checked? (to log changes only)
     
     /// Copy from another object
     void CopyFrom (const LiveATCDataTy& o) { *this = o; }
@@ -100,6 +134,14 @@ struct LiveATCDataTy {
     inline bool IsATIS () const
     { return streamName.find("ATIS") != std::string::npos; }
 
+    /// @brief Can the airport's station be received from the plane's position?
+    /// @details Checks distance against radio reach, and optionally terrain
+    ///          line of sight. While line of sight is not yet known the
+    ///          station is considered receivable.
+    /// @param planePos Plane's position incl. altitude
+    /// @param[out] pDist_nm Receives the distance to the airport if given
+    bool IsInReach (const positionTy& planePos, double* pDist_nm = nullptr) const;
+
     /// Textual summary (Icao if needed + stream name)
     inline std::string Summary () const
     { return startsWith(streamName, airportIcao) ? streamName : airportIcao+'|'+streamName; }
@@ -111,6 +153,178 @@ struct LiveATCDataTy {
 /// Map of data returned by LiveATC, key is airport ICAO
 typedef std::map<std::string,LiveATCDataTy> LiveATCDataMapTy;
 
+/// @brief Parses one airport section of a LiveATC search result page
+/// @param apSec The section, starting with `LIVE_ATC_SECTION`
+/// @param[out] streamData Receives the stream's data
+/// @return Found an UP stream?
+bool ParseFeedSection (const std::string& apSec, LiveATCDataTy& streamData);
+
+
+/// [ms] Stop paths are expected to return within that time, the actual stopping is done by the reaper
+constexpr int REAPER_STOP_BOUND_MS = 2;
+
+class COMChannel;
+
+/// Media player's state as reported by libVLC's events
+enum PlayerStateTy : uint8_t {
+    PLAYER_IDLE = 0,                ///< nothing happened yet
+    PLAYER_OPENING,                 ///< opening the media
+    PLAYER_BUFFERING,               ///< buffering, see PlayerTy::GetBufferingPct()
+    PLAYER_PLAYING,                 ///< playing
+    PLAYER_STOPPED,                 ///< stopped
+    PLAYER_ENDED,                   ///< end of stream reached, e.g. the feed dropped out
+    PLAYER_ERROR,                   ///< libVLC encountered an error
+};
+
+/// @brief VLC media player, which keeps its state up to date from libVLC's events
+/// @details Status queries just read atomics instead of calling into libVLC.
+///          Events, which matter to the channels using the player,
+///          are passed on to them right away.
+class PlayerTy : public VLC::MediaPlayer
+{
+protected:
+    std::atomic<PlayerStateTy> state{PLAYER_IDLE};  ///< state as per last event
+    std::atomic<float> bufPct{0.0f};                ///< [%] buffering progress as per last event
+    std::array<std::atomic<COMChannel*>,COM_CNT_MAX> notify;    ///< channels to inform about events, by channel index
+    
+public:
+    /// Creates the player and subscribes to its events
+    PlayerTy (VLC::Instance& inst);
+    /// Unsubscribes from events
+    ~PlayerTy ();
+    
+    /// State as per last event
+    PlayerStateTy GetState () const { return state; }
+    /// Playing?
+    bool IsPlaying () const { return state == PLAYER_PLAYING; }
+    /// Has playback failed, by error or as the stream ended?
+    bool HasFailed () const { return state >= PLAYER_ENDED; }
+    /// [%] Buffering progress
+    float GetBufferingPct () const { return bufPct; }
+    /// Have the channel informed about events
+    void Notify (COMChannel* pChn);
+    
+protected:
+    /// libVLC's event callback, called in one of libVLC's threads
+    static void cbEvent (const libvlc_event_t* ev, void* data);
+};
+
+/// Shared pointer to a media player, shared by all streams playing the same feed
+typedef std::shared_ptr<PlayerTy> MediaPlayerPtrTy;
+/// Shared pointer to a media, shared by all streams playing the same feed
+typedef std::shared_ptr<VLC::Media> MediaPtrTy;
+
+/// @brief Background thread stopping and destroying VLC media players
+/// @details libVLC's `stop()` can block for hundreds of milliseconds while
+///          tearing down network and audio output. Stop paths therefore
+///          just hand over the media player and media, and the reaper
+///          owns them until they are destroyed.
+///          Also collects statistics on the time spent in stop paths.
+class StreamReaperTy
+{
+protected:
+    /// A media player, its media, and its audio feed waiting to be stopped and destroyed
+    struct CorpseTy {
+        MediaPlayerPtrTy    pMP;
+        MediaPtrTy          pMedia;
+        AudioFeedPtrTy      pFeed;      ///< must outlive the player's playback
+    };
+    std::list<CorpseTy> corpses;            ///< waiting to be reaped
+    bool bBusy = false;                     ///< reaper is reaping right now
+    bool bStop = false;                     ///< shall the reaper stop?
+    std::thread thr;                        ///< the reaper thread
+    std::mutex mtx;                         ///< guards all of the above
+    std::condition_variable cv;             ///< signals new corpses or empty list
+    
+    // Statistics
+    unsigned long cntReaped = 0;            ///< media players reaped
+    double maxReapMs = 0.0;                 ///< [ms] longest time it took to reap one media player
+    unsigned long cntStop = 0;              ///< number of measured stop paths
+    unsigned long cntStopSlow = 0;          ///< number of stop paths exceeding `REAPER_STOP_BOUND_MS`
+    double sumStopMs = 0.0;                 ///< [ms] total time in stop paths
+    double maxStopMs = 0.0;                 ///< [ms] longest time in a stop path
+    
+public:
+    /// Start the reaper thread
+    void Start ();
+    /// Reap everything handed over, then stop the reaper thread
+    void Stop ();
+    /// @brief Wait till all handed over media players are destroyed
+    /// @warning Blocks! Needed before the VLC instance can go
+    void Drain ();
+    
+    /// @brief Take over a media player, its media, and audio feed, never blocks beyond a short lock
+    /// @details If the reaper isn't running then they are destroyed right away
+    void HandOver (MediaPlayerPtrTy&& pMP,
+                   MediaPtrTy&& pMedia,
+                   AudioFeedPtrTy&& pFeed);
+    
+    /// Record time spent in a stop path
+    void RecordStop (std::chrono::steady_clock::duration d);
+    /// Log statistics
+    void LogStats ();
+    
+protected:
+    /// Reaper thread's main loop
+    void Run ();
+};
+
+/// The global stream reaper
+extern StreamReaperTy gReaper;
+
+/// @brief Registry of media players playing a feed, by final URL
+/// @details With the mixer active several streams (COM1 and COM2 on the
+///          same frequency, stand-by pre-buffering the active feed, warm
+///          streams) share one media player, i.e. one network connection
+///          and one decoder. Each stream reads the feed with its own voice,
+///          having its own desync, gain, and mute.
+///          The last stream leaving hands the player over to the reaper.
+class StreamShareTy
+{
+public:
+    /// A media player, its media, and its audio feed
+    struct SharedTy {
+        MediaPlayerPtrTy    pMP;
+        MediaPtrTy          pMedia;
+        AudioFeedPtrTy      pFeed;
+    };
+protected:
+    /// Weak references to a shared media player, its media, and feed
+    struct EntryTy {
+        std::weak_ptr<PlayerTy>         pMP;
+        std::weak_ptr<VLC::Media>       pMedia;
+        std::weak_ptr<AudioFeedTy>      pFeed;
+    };
+    std::map<std::string,EntryTy> mapShared;    ///< shared players by final URL
+    std::mutex mtx;                             ///< guards `mapShared` and reference counting of shared players
+    std::atomic<unsigned long> cntJoined{0};    ///< statistics: number of times a player was shared
+    
+public:
+    /// Offer a playing media player for sharing
+    void Publish (const std::string& url, const SharedTy& sh);
+    /// @brief Find a media player already playing `url`
+    /// @return Shared references to player, media, and feed, all empty if there is none
+    SharedTy Join (const std::string& url);
+    /// @brief Release a stream's references to a player
+    /// @details If others still use the player then the references are reset,
+    ///          otherwise the player is unlisted and the caller is to hand it over to the reaper
+    /// @return Is the caller the last one using the player?
+    bool Leave (MediaPlayerPtrTy& pMP, MediaPtrTy& pMedia, AudioFeedPtrTy& pFeed);
+    /// Number of times a player was shared
+    unsigned long GetJoinedCnt () const { return cntJoined; }
+};
+
+/// The global registry of shared media players
+extern StreamShareTy gShares;
+
+/// Measures the time spent in a stop path from construction to destruction
+class StopTimerTy
+{
+protected:
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+public:
+    ~StopTimerTy () { gReaper.RecordStop(std::chrono::steady_clock::now() - tStart); }
+};
 
 /// Adds frequency and VLC data
 struct StreamCtrlTy : public LiveATCDataTy {
@@ -124,17 +338,31 @@ protected:
     LiveATCDataMapTy mapAirportStream;
     /// Network read buffer for LiveATC response
     std::string readBuf;
-    /// Time point when audio desync should be finished (fair guess)
+    /// Time point when audio desync should be finished (fair guess, refined by the voice's fill level)
     std::chrono::time_point<std::chrono::steady_clock> desyncDone;
+    /// [s] Audio desync period last set
+    long desyncSecsSet = 0;
+    /// [s] Audio desync period last asked for, can be more than the buffer limit allows
+    long desyncSecsWanted = 0;
     /// last volume set, value to be restored when unmuting
     int volume = 100;
     /// Muted? Which is simulated by setting volume = 0
     bool bMute = false;
+    /// Duck other channels while this stream carries a signal? (mixer only)
+    bool bDuckOthers = false;
+    /// Volume last applied to voice or player, -1 if nothing applied yet
+    int appliedVol = -1;
+    /// Ducking last applied to the voice
+    bool appliedDuck = false;
+    /// Time point when the current airport stream was selected
+    std::chrono::time_point<std::chrono::steady_clock> apSelected;
 
 public:
     // VLC control
-    std::unique_ptr<VLC::MediaPlayer>   pMP;    ///< VLC media player
-    std::unique_ptr<VLC::Media>         pMedia; ///< VLC media to be played, changes with new LiveATC streams
+    MediaPlayerPtrTy    pMP;    ///< VLC media player, created when needed, see EnsurePlayer(), maybe shared with other streams
+    MediaPtrTy          pMedia; ///< VLC media to be played, changes with new LiveATC streams
+    AudioFeedPtrTy      pFeed;  ///< player's decoded audio, if the mixer is active
+    AudioVoicePtrTy     pVoice; ///< this stream's reading of `pFeed` as passed to the mixer
     
 public:
     /// @brief Set frequency including frequency string
@@ -144,8 +372,21 @@ public:
     inline int GetFrequ () const { return frequ; }
     inline std::string GetFrequStr () const { return frequString; }
     
-    /// Is VLC properly initialized?
-    inline bool IsValid() const { return bool(pMP); }
+    /// Has a media player?
+    inline bool HasPlayer() const { return bool(pMP); }
+    /// Create the media player if there is none yet, applies volume and mute
+    bool EnsurePlayer ();
+    /// @brief Route the player's audio to the mixer if the mixer is active, creates feed and voice
+    /// @note Must be called before playback starts
+    /// @param desyncSecs Audio desync period, which the voice needs to buffer and delays the audio by
+    void AttachVoice (long desyncSecs);
+    /// Remove the voice from the mixer and leave the media player, the last one hands it over to the reaper
+    void ReleasePlayer ();
+    /// [bytes] memory held by the network read buffer and the feed's audio buffer
+    inline unsigned long GetBufBytes () const
+    { return (unsigned long)readBuf.capacity() + (pFeed ? pFeed->GetBytes() : 0); }
+    /// Release the network read buffer's memory
+    inline void ReleaseBuffers () { std::string().swap(readBuf); }
     /// stream's status
     StreamStatusTy GetStatus() const;
     /// Is COM channel defined, i.e. at least a frequency set?
@@ -155,25 +396,44 @@ public:
     /// Set as pre-buffering
     inline void SetStandbyPrebuf(bool b) { bStandbyPrebuf=b; }
 
-    /// Query LiveATC, parse result, update `curr` with found stream if any
-    bool FetchUrlForFrequ ();
+    /// @brief Query LiveATC, parse result, update `curr` with found stream if any
+    /// @param planePos User's plane position
+    bool FetchUrlForFrequ (const positionTy& planePos);
     /// Parses `readBuf` for airports and relevant streams
     void ParseForAirportStreams ();
     /// @brief Find closest airport in `mapAirportStream`
+    /// @param planePos User's plane position
     /// @return Iterator pointing to airportStream data with updated airportPos
-    LiveATCDataMapTy::iterator FindClosestAirport();
+    LiveATCDataMapTy::iterator FindClosestAirport(const positionTy& planePos);
     /// The end iterator is needed to work with the above result
     inline LiveATCDataMapTy::iterator AirportStreamsEnd() { return mapAirportStream.end(); }
+    /// @brief Take over the airport stream data and remember when this selection happened
+    /// @param apData Airport stream to select, typically as returned by FindClosestAirport()
+    void SelectAirport (const LiveATCDataTy& apData);
+    /// Seconds since the current airport stream was selected
+    int GetSecSinceAirportSelected () const;
 
     /// @brief Set audio desync, also sets the time when done
+    /// @details With the mixer the voice delays the audio, limited by its buffer size
     /// @param sec Seconds to delay the audio playback for desync
     void SetAudioDesync (long sec);
+    /// @brief Change the audio desync period of a playing stream without restarting it
+    /// @details The voice inserts silence or skips quiet parts, VLC's own output resyncs itself.
+    ///          Minor changes below `CHN_DESYNC_RETARGET_S` are ignored,
+    ///          so is a period asked for before but beyond the buffer limit.
+    /// @param sec New period in seconds
+    /// @return Was the period changed?
+    bool RetargetDesync (long sec);
+    /// [s] Audio desync period last set
+    long GetDesyncSecs () const { return desyncSecsSet; }
     /// Seconds till audio desync is done
     int GetSecTillDesyncDone () const;
     /// Is audio desync still under way?
     inline bool IsDesyncing() const  { return GetSecTillDesyncDone() > 0; }
     /// Is audio desync done?
     inline bool IsDesyncDone() const { return GetSecTillDesyncDone() <= 0; }
+    /// Time point when audio desync is done, based on the buffered audio if the voice delays it
+    std::chrono::time_point<std::chrono::steady_clock> GetDesyncDone () const;
     /// Clears the desync timer (and only the timer, does not change VLC's desync setting)
     inline void ClearDesyncTimer () { desyncDone = std::chrono::time_point<std::chrono::steady_clock>(); }
 
@@ -187,47 +447,231 @@ public:
     /// @brief Set (un)mute
     /// @param mute Mute? or unmute?
     void SetMute(bool mute);
+    /// Duck other channels while this stream carries a signal? (mixer only)
+    void SetDuckOthers(bool b);
+    /// Record the stream's audio into this history, `nullptr` to stop recording (mixer only)
+    void SetRecorder(ReplayRingTy* r);
+protected:
+    /// @brief Apply volume, mute, and ducking to the voice or, without mixer, to the media player
+    /// @param bForce Apply even if unchanged, needed for a new voice or player
+    void ApplyVolume (bool bForce = false);
+public:
+    /// @brief Apply the radio effect, if configured, with static scaled by distance (mixer only)
+    /// @param planePos Plane's position to determine the distance to the station
+    void ApplyRadioFx (const positionTy& planePos);
 
-    /// Stops playback and clears all data
+    /// @brief Stops playback and clears all data
+    /// @details If something was played then the media player is handed over
+    ///          to the reaper. A new one is only created when needed again.
     void StopAndClear ();
     
     /// Textual summary (stream and status)
-    inline std::string Summary (StreamStatusTy eStatus = STREAM_NOT_INIT) const
-    { return LiveATCDataTy::Summary() + " (" + GetStatusStr(eStatus ? eStatus : GetStatus()) + ")"; }
+    std::string Summary (StreamStatusTy eStatus = STREAM_NOT_INIT) const;
     /// Textual debug output, e.g. for log file
     inline std::string dbgStatus () const
     { return LiveATCDataTy::dbgStatus() + '|' + GetStatusStr(GetStatus()); }
 };
 
-/// Represents one COM channel, its frequency and playback streams.
+/// @brief A muted stream kept running for a quick handover
+/// @details Recently active streams are kept for a quick flip back,
+///          likely next streams are started in advance. Once tuned to,
+///          the stream has (ideally) passed its audio desync period already.
+struct WarmStreamTy {
+    StreamCtrlTy strm;          ///< the stream, always muted while in the pool
+    unsigned long id = 0;       ///< unique id, tasks use it to find the entry again
+    double likelihood = 0.0;    ///< [0..1] likelihood to be tuned next
+    bool bPredicted = false;    ///< started because of a prediction by flight phase?
+    bool bStartQueued = false;  ///< is the startup task, see COMChannel::StartWarmStream(), still queued?
+    /// when was the stream added to the pool?
+    std::chrono::time_point<std::chrono::steady_clock> created;
+    /// when was the stream last audible or last requested?
+    std::chrono::time_point<std::chrono::steady_clock> lastUsed;
+    
+    /// Seconds since last use
+    int GetSecSinceUsed () const;
+    /// Eviction score, the lower the sooner the stream is stopped
+    double Score () const { return Score(likelihood, GetSecSinceUsed()); }
+    /// @brief Eviction score: likelihood plus recency
+    /// @param l Likelihood to be tuned next
+    /// @param ageS Seconds since last use
+    static double Score (double l, int ageS) { return l + 1.0 / (1.0 + ageS / 60.0); }
+};
+
+/// List of warm streams
+typedef std::list<WarmStreamTy> WarmStreamListTy;
+
+/// Commands posted to a COM channel's state machine
+enum ChnCmdTy {
+    CHN_CMD_TICK = 0,           ///< regular update, every second
+    CHN_CMD_TUNE,               ///< active frequency changed
+    CHN_CMD_STANDBY,            ///< stand-by frequency changed
+    CHN_CMD_STOP,               ///< channel no longer monitored: stop all playback
+    CHN_CMD_VOLUME,             ///< volume or mute status changed
+    CHN_CMD_AUDIO_DEV,          ///< audio output device changed
+    CHN_CMD_REPLAY,             ///< "say again": replay the last transmission
+};
+
+/// X-Plane inputs, collected in the main thread, passed along with each command
+struct ChnInputTy {
+    int frequ = 0;              ///< active frequency as returned by XP
+    int frequStandby = 0;       ///< stand-by frequency as returned by XP
+    positionTy planePos;        ///< user's plane position
+    long desyncSecs = 0;        ///< [s] audio desync period
+    int volume = 100;           ///< volume (0-100)
+    bool bMute = false;         ///< muted globally or because COM not selected
+    bool bTx = false;           ///< COM selected for transmit, ducks other channels
+    std::string audioDev;       ///< VLC audio output device id
+    FlightPhaseTy phase = PHASE_UNKNOWN;    ///< current flight phase
+};
+
+/// A command message posted to a COM channel
+struct ChnMsgTy {
+    ChnCmdTy cmd = CHN_CMD_TICK;    ///< what to do
+    ChnInputTy in;                  ///< X-Plane's state when posted
+};
+
+/// @brief Status of a COM channel as published by its executor
+/// @details Fixed-size and trivially copyable so that renderers can read it
+///          through a SeqLockTy without locks, allocations, or VLC calls
+struct ChnStatusTy {
+    StreamStatusTy status = STREAM_NOT_INIT;    ///< channel's status
+    char summary[120] = "";                     ///< textual summary of the active stream
+    char summaryPrev[120] = "";                 ///< textual summary of the previous or stand-by stream
+    char streamName[60] = "";                   ///< active stream's name
+    char airportIcao[8] = "";                   ///< active stream's airport
+    int nPlayers = 0;                           ///< media players held, including warm streams
+    unsigned long bufBytes = 0;                 ///< [bytes] memory held by network read and audio desync buffers
+    /// Time point when the active stream's audio desync is done
+    std::chrono::time_point<std::chrono::steady_clock> desyncDone;
+    
+    /// Seconds till audio desync is done
+    inline int GetSecTillDesyncDone () const
+    { return int(std::chrono::duration_cast<std::chrono::seconds>
+                 (desyncDone - std::chrono::steady_clock::now()).count()); }
+    /// Is audio desync still under way?
+    inline bool IsDesyncing() const  { return GetSecTillDesyncDone() > 0; }
+};
+
+/// Size of a channel's command queue
+constexpr size_t CHN_CMD_QUEUE_SIZE = 64;
+/// [ms] Period of the airport distance check
+constexpr int CHN_REACH_CHECK_MS = 10000;
+/// [ms] Period of pre-buffering maintenance: warm pool, stand-by, prediction
+constexpr int CHN_PREBUF_CHECK_MS = 10000;
+/// [ms] Stand-by frequency must be stable for that long before pre-buffering starts
+constexpr int CHN_STBY_STABLE_MS = 5000;
+/// [ms] Desync expiry is rescheduled only if the expected end moved by more than that
+constexpr int CHN_DESYNC_RESCHED_MS = 500;
+/// [s] A playing stream's audio desync is retargeted only if the period changed by at least that much
+constexpr long CHN_DESYNC_RETARGET_S = 2;
+/// [s] A failed stream is restarted at most once in that period
+constexpr int CHN_RESTART_MIN_S = 30;
+
+/// @brief Represents one COM channel, its frequency and playback streams.
+/// @details The channel is a state machine owned by one executor:
+///          All stream data (`curr`, `prev`, frequencies, VLC objects)
+///          is only touched by tasks of this channel in the worker pool,
+///          which never run in parallel. The main thread only collects
+///          X-Plane's state and posts commands through a lock-free queue.
 class COMChannel
 {
 protected:
     int idx = -1;               ///< COM idx, starting from 0
     
+    // *** Executor-owned data, only accessed by this channel's tasks ***
+    
     /// Two sets of data, one in use, one being phased out
     StreamCtrlTy dataA, dataB;
     /// Pointers indicating which of the two sets is active, which one is being phased out
     StreamCtrlTy *curr = &dataA, *prev = &dataB;
-    /// Indicates if a stream is starting up right now
-    std::atomic_flag flagStartingStream = ATOMIC_FLAG_INIT;
+    /// X-Plane's state as passed in with the last command
+    ChnInputTy inp;
+    /// `curr`'s desync end the desync expiry job was last started for
+    std::chrono::time_point<std::chrono::steady_clock> desyncJobDone;
+    /// Is the desync expiry job started?
+    bool bDesyncJob = false;
     
-protected:
-    /// Stored future when using std::async, typically not used later on
-    std::future<void> futVlcStart;
+    // Statistics on airport switching
+    std::chrono::time_point<std::chrono::steady_clock> statsStart;  ///< when did we start counting?
+    int cntApSwitch = 0;        ///< number of airport switches
+    int cntApSwitchHold = 0;    ///< number of times ShallSwitchAirport() started suppressing a switch
+    int cntRestart = 0;         ///< number of stream (re)starts in VLC
+    /// Per stream (`curr`, `prev`): airport and reason we currently do _not_ switch to, empty if none
+    std::string apSwitchHold[2];
+    
+    // Statistics on next frequency prediction
+    int cntPredict = 0;         ///< number of predicted frequencies warmed up
+    int cntPredictHit = 0;      ///< number of predicted frequencies then actually tuned
+    double predictSecs = 0.0;   ///< [s] time predicted streams were running, i.e. the bandwidth cost
+    
+    /// Last time the channel had any stream defined, for idle reclamation
+    std::chrono::time_point<std::chrono::steady_clock> tLastBusy = std::chrono::steady_clock::now();
+    /// Idle resources released already?
+    bool bIdleReleased = false;
+    
+    /// History of received audio for "say again", created on first tick with the mixer active
+    std::unique_ptr<ReplayRingTy> pReplay;
+    /// Tried creating `pReplay` already? (Don't retry after failure)
+    bool bReplayTried = false;
+    /// Voice replaying the last transmission
+    AudioVoicePtrTy replayVoice;
+    /// Last time a failed stream was restarted
+    std::chrono::time_point<std::chrono::steady_clock> tLastFailRestart;
+    
+    /// Warm streams: muted, buffering, ready for handover
+    WarmStreamListTy warmPool;
+    unsigned long nextWarmId = 1;   ///< id of the next warm stream
+    
+    // *** Shared between main thread and executor ***
+    
+    /// Commands from the main thread to the executor
+    SPSCQueueTy<ChnMsgTy,CHN_CMD_QUEUE_SIZE> cmdQueue;
+    /// Is a task processing the command queue posted already?
+    std::atomic<bool> bCmdTaskPosted{false};
+    /// Is StartStream() running right now?
+    std::atomic<bool> bStarting{false};
     /// make StartStream() stop early
-    volatile bool bAbortStart = false;
+    std::atomic<bool> bAbortStart{false};
+    /// priority of the StartStream() task last started
+    std::atomic<WorkPrioTy> prioStart{WORK_TUNE};
+    /// Shall X-Plane's ATIS be suppressed because of this channel?
+    std::atomic<bool> bSuppressXPAtis{false};
+    /// Status published for UI and drawing callbacks
+    SeqLockTy<ChnStatusTy> snapStatus;
+    /// Number of warm streams of this channel
+    std::atomic<int> cntWarm{0};
+    /// Number of warm streams of all channels, limited by DataRefs::GetWarmPoolSize()
+    static std::atomic<int> cntWarmAll;
+    /// VLC initialized and ready? (main thread only)
+    static bool bVLCReady;
+    
+    // *** Main thread only ***
+    
+    bool bVLCInit = false;      ///< channel initialized for VLC, see InitVLC()
+    bool bActive = false;       ///< channel considered active, i.e. commands posted
+    int postedFrequ = 0;        ///< last active frequency posted
+    int postedStandby = 0;      ///< last stand-by frequency posted
+    int seenFrequ = 0;          ///< active frequency seen in the previous call, to detect a stable change
+    bool postedMute = false;    ///< last mute status posted
+    bool postedTx = false;      ///< last transmit selection posted
+    
+    // *** Jobs in the timer wheel, registered by the main thread ***
+    
+    TimerIdTy jobReach = 0;     ///< periodic: airport distance check
+    TimerIdTy jobPrebuf = 0;    ///< periodic: pre-buffering maintenance
+    TimerIdTy jobStby = 0;      ///< one-shot: stand-by frequency became stable
+    TimerIdTy jobDesync = 0;    ///< one-shot: `curr`'s desync done, `prev` can go
     
 public:
 
     /// @brief Constructor does not init VLC
-    /// @param i 0-based COM index, usually 0 or 1
+    /// @param i 0-based channel index, 0 and 1 are X-Plane's COM1 and COM2
     COMChannel(int i);
     
     /// Destructor calls CleanupVLC()
     ~COMChannel();
     
-    /// Initialize the VLC smart pointers, can fail if wrong directory configured
+    /// Prepare the channel for VLC, media players are only created once streams start
     bool InitVLC();
     
     /// Cleans up the VLC smart pointers in a proper order
@@ -236,19 +680,24 @@ public:
     /// Is VLC properly initialized?
     bool IsValid() const;
     
-    /// COM index, typically just 0 or 1
+    /// Channel index, 0 and 1 are X-Plane's COM1 and COM2
     inline int GetIdx() const { return idx; };
 
-    // X-Plane data
-    
-    /// Current LiveATC data
-    const StreamCtrlTy& GetStreamCtrlData() const     { return *curr; }
-    
+    /// Status as last published by the executor, safe to read from any thread without blocking
+    ChnStatusTy GetStatusSnapshot () const { return snapStatus.Read(); }
 
-    /// Called every second: start new streams, stop out of reach ones...
-    void RegularMaintenance ();
+    /// @brief Called regularly from the main thread: posts frequency changes and a tick
+    /// @details Never blocks, all work is done by the channel's executor.
+    ///          Frequency checks are plain integer compares, so this is cheap
+    ///          enough to be called several times a second.
+    /// @param bTick Post a regular tick? (Expected once a second)
+    /// @return Did any frequency change?
+    bool RegularMaintenance (bool bTick);
+    
+    /// Is the channel busy tuning, buffering, or desyncing, so that changes are to be expected soon?
+    bool IsTransitioning () const;
 
-    /// Stop all playback, reset frequency and other data.
+    /// Stop all playback, reset frequency and other data. Posts a stop command, doesn't block.
     void ClearChannel();
     
     // VLC status
@@ -258,18 +707,45 @@ public:
     /// Is COM channel defined / has frequency?
     inline bool IsDefined() const { return GetStatus() >= STREAM_NOT_PLAYING; }
 
-    /// @brief Textual status summary for end user
+    /// @brief Textual status summary for end user, taken from the status snapshot
     /// @param bPrev Report `prev` instead of `curr`?
     std::string Summary (bool bPrev = false) const;
     /// @brief Textual status summary for debug purposes
     /// @param bPrev Report `prev` instead of `curr`?
     std::string dbgStatus (bool bPrev = false) const;
+    
+    /// Log switch and restart counts, also as rates per flight hour
+    void LogSwitchStats () const;
+    /// Log hit rate of frequency predictions
+    void LogPredictStats () const;
 
 public:
     // Static functions to act on *all* COM channel objects
     
-    /// Initialize *all* VLC instances
+    /// @brief Returns the channel object of the given index
+    /// @param i 0-based channel index
+    /// @param bCreate Create the channel object if it does not exist yet?
+    /// @return `nullptr` if `i` is not a configured channel or the channel does not exist yet
+    static COMChannel* Get (int i, bool bCreate = false);
+    
+    /// Textual status summary of a channel, empty if the channel does not exist
+    static std::string GetSummary (int i, bool bPrev = false);
+    
+    /// Log resources used by all channels: players, streams, threads
+    static void LogResourceStats ();
+    
+    /// @brief Initialize *all* VLC instances
+    /// @warning Blocks until VLC has loaded its plugins, see InitAllVLCAsync()
     static bool InitAllVLC();
+    /// @brief Start initializing VLC in a background thread
+    /// @details Channels stay in `STREAM_NOT_INIT` until CheckVLCInit() has found the initialization done
+    static void InitAllVLCAsync();
+    /// @brief Check if the background initialization has finished, takes over its results
+    /// @param bWait Wait for the initialization to finish? (Blocks!)
+    /// @return `true` if initialization just finished successfully
+    static bool CheckVLCInit (bool bWait = false);
+    /// Is VLC initialized and ready for the channels to create media players?
+    static bool IsVLCReady () { return bVLCReady; }
     
     /// Stop *all* still running VLC playbacks of *all* COM channels
     static void StopAll();
@@ -286,12 +762,20 @@ public:
 
     /// Set the volume of all playback streams
     static void SetAllVolume(int vol);
+    
+    /// @brief "Say again": replay the last transmission received on a channel
+    /// @param i 0-based channel index
+    static void SayAgain (int i);
 
     /// (un)Mute all playback streams
     static void MuteAll(bool bDoMute = true);
     
-    /// checks if there is any active stream playing ATIS
-    static bool AnyATISPlaying();
+    /// checks if any channel requires X-Plane's ATIS to be suppressed
+    static bool AnyXPAtisSuppressed();
+    
+    /// @brief A media player of this channel changed state (playing, ended, error)
+    /// @details Called from VLC's event thread, only posts PlayerEvent() to the executor
+    void NotifyPlayerEvent ();
     
 protected:
     /// @brief Initial stand-by frequency when frequencies were swapped
@@ -299,48 +783,149 @@ protected:
     /// from an initial value as only then pre-buffering applies.
     int initFrequStandBy = 0;
     
-    /// @brief Last seen dialed-in stand-by frequency.
-    /// Stored to detect a stable _change_ to a new stand-by frequency
+    /// @brief Last stable dialed-in stand-by frequency.
+    /// Set when the stand-by frequency didn't change for `CHN_STBY_STABLE_MS`
     int lastFrequStandby = 0;
     
+    // *** Main thread: posting commands ***
+    
+    /// Collect X-Plane's current state for this channel
+    ChnInputTy GetInput () const;
+    /// @brief Post a command to the channel's executor
+    /// @return `false` if the command queue is full
+    bool PostCmd (ChnCmdTy cmd);
+    
+    // *** Executor: the state machine ***
+    
+    /// Process all queued commands
+    void ProcessCmds ();
+    /// Process one command
+    void HandleCmd (const ChnMsgTy& msg);
+    /// Regular checks every second: radio effect, idle reclamation
+    void Tick ();
+    /// Release media players and buffers of an idle channel
+    void ReleaseIdle ();
+    /// Open the history of received audio, if configured, and have `curr` record into it
+    void UpdateReplay ();
+    /// Replay the last transmission from the history
+    void Replay ();
+    /// Stop a replay
+    void StopReplay ();
+    /// Job: check distance and then might stop the channel, or switch over to another radio
+    void CheckReach ();
+    /// Job: a media player reported a state change
+    void PlayerEvent ();
+    /// Restart `curr` if its player has failed or the stream ended, rate-limited by `CHN_RESTART_MIN_S`
+    void RestartFailed ();
+    /// Job: maintain warm pool, pre-buffer stand-by frequency, predict next frequency
+    void CheckPrebuf ();
+    /// Job: stand-by frequency has been stable for a while, start pre-buffering
+    void StandbyStable ();
+    /// Job: `curr`'s audio desync is done, retire `prev`
+    void DesyncExpired ();
+    /// (Re)start the desync expiry job if `curr`'s desync end changed
+    void ScheduleDesyncExpiry ();
+    /// @brief Post a job's work to the channel's executor
+    /// @details Posted with control priority so that it is executed in order with commands
+    void PostJob (void (COMChannel::*fn)());
+    /// Register (if needed) and start the periodic jobs, staggered across channels
+    void StartJobs ();
+    /// Remove all jobs from the timer wheel
+    void RemoveJobs ();
+    /// Update the flag telling if X-Plane's ATIS is to be suppressed
+    void UpdateXPAtisFlag ();
+    /// Publish the current status to `snapStatus`
+    void PublishStatus ();
+    
     /// @brief Checks for and performs change in frequency
     /// @param _new New frequency in Hz as returned by XP.
     bool doChange(int _new);
     
     /// @brief Checks for and starts pre-buffering of the standby frequency.
-    /// @param _new Current standby frequency in Hz as returned by XP.
+    /// @param _new Stand-by frequency in Hz, which has been stable for a while
     bool doStandbyPrebuf(int _new);
 
     // VLC control
     
-    /// @brief Start a stream asynchronously by calling StartStream() via `std::async`
+    /// @brief Start a stream asynchronously by posting StartStream() to the worker pool
+    /// @details Never blocks. Queued startups of lower or same priority are dropped.
     /// @param bStandby Start the stand-by frequncy stream for pre-buffering? Otherwise start `curr`
-    void StartStreamAsync (bool bStandby);
+    /// @param prio Priority of the startup
+    void StartStreamAsync (bool bStandby, WorkPrioTy prio);
     /// @brief Blocking call to start a stream
     /// @param bStandby Start the stand-by frequncy stream for pre-buffering? Otherwise start `curr`
     void StartStream (bool bStandby);
+    /// @brief Find the stream's URL, queries LiveATC if needed, resolves .pls playlists
+    /// @warning Blocks for HTTP requests
+    bool ResolveStreamUrl (StreamCtrlTy& strm);
+    /// @brief Create the media and start playback
+    /// @param strm Stream with a resolved `playUrl`
+    /// @param desyncSecs Audio desync period to apply
+    bool PlayStream (StreamCtrlTy& strm, long desyncSecs);
     /// @brief Stop `curr` or `prev` stream immediately
     /// @param bPrev Stop `prev`? (Otherwise stop `curr`)
     void StopStream (bool bPrev);
     
+    // Warm stream pool
+    
+    /// @brief Keep `curr` or `prev` stream muted in the warm pool instead of stopping it
+    /// @param bPrev Retire `prev`? (Otherwise `curr`)
+    /// @param likelihood Likelihood that the stream will be tuned again soon
+    /// @return `false` if the stream was stopped instead
+    bool RetireStream (bool bPrev, double likelihood = 0.0);
+    /// @brief Start a muted warm stream for a likely next frequency
+    /// @param frequ Frequency to warm up
+    /// @param likelihood Likelihood that the frequency will be tuned next
+    /// @param bPredicted Is this a prediction by flight phase? (for statistics)
+    /// @return Has a warm-up been started?
+    bool WarmUp (int frequ, double likelihood, bool bPredicted = false);
+    /// Predicts the next frequency from the flight phase and the current airport's streams, and warms it up
+    void PredictNext ();
+    /// Task: Start the warm stream with the given id
+    void StartWarmStream (unsigned long id);
+    /// @brief Find a warm stream on the given frequency
+    /// @param bForHandover Only streams which play and are in reach, preferring those done with desync
+    WarmStreamListTy::iterator FindWarm (int frequ, bool bForHandover);
+    /// @brief Reserve room for one more warm stream
+    /// @details Evicts this channel's warm streams that score lower than `score`
+    ///          till the budget allows for one more
+    bool ReserveWarm (double score);
+    /// Stop and remove a warm stream
+    void EvictWarm (WarmStreamListTy::iterator it);
+    /// Stop warm streams out of reach or unused for too long
+    void MaintainWarmPool ();
+    /// Stop all warm streams
+    void ClearWarmPool ();
+    
     /// determines and sets proper volum/mute status
     void SetVolumeMute ();
     
-    /// Checks if an async StartStream() operation is in progress
+    /// @brief Decides if switching from the stream's current airport to `apIter` is worth it
+    /// @param strm The stream currently tuned to an airport
+    /// @param apIter The airport currently closest to the plane
+    /// @param bAudible Is the stream audible, i.e. would a switch cause audio to be lost?
+    bool ShallSwitchAirport (const StreamCtrlTy& strm,
+                             const LiveATCDataMapTy::iterator& apIter,
+                             bool bAudible);
+    
+    /// Checks if an async StartStream() operation is queued or in progress
     bool IsAsyncRunning () const;
-    /// Aborts StartStream()) and waits for it to complete
+    /// Aborts StartStream() and all queued tasks and waits for them to complete
+    /// @warning Blocks! Not to be called from the flight loop
     void AbortAndWaitForAsync ();
 
     // *** Determination of stream URL to play ***
-    /// Turn `curr` stream into `prev`
-    void TurnCurrToPrev ();
+    /// @brief Turn `curr` stream into `prev`
+    /// @param bKeepWarm Keep a still running `prev` in the warm pool instead of stopping it
+    void TurnCurrToPrev (bool bKeepWarm = false);
 };
 
 //
-// MARK: Global array
+// MARK: Global list of channels
 //
 
-extern COMChannel gChn[COM_CNT];
+/// All channels created so far, index equals channel index, see COMChannel::Get()
+extern std::deque<COMChannel> gChn;
 
 extern std::vector<VLC::AudioOutputDeviceDescription> gVLCOutputDevs;
 
@@ -0,0 +1,130 @@
+//
+//  PLALineOfSight.h
+//  PlayLiveATC
+//
+// Terrain line-of-sight checks between plane and airport stations,
+// performed incrementally in small per-frame time slices
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLALineOfSight_h
+#define PLALineOfSight_h
+
+#define DBG_LOS_DONE        "Line of sight to %s: %s (%d samples in %d frames, %lldus total, max slice %lldus)"
+
+constexpr double LOS_GRID_DEG       = 0.05;     ///< [°] size of a plane's grid cell for caching results (about 3nm)
+constexpr double LOS_GRID_ALT_M     = 300;      ///< [m] height of a plane's grid cell for caching results (about 1000ft)
+constexpr double LOS_SAMPLE_DIST_M  = 1852;     ///< [m] distance between two terrain samples along the path
+constexpr int LOS_MAX_SAMPLES       = 150;      ///< maximum number of samples per path
+constexpr size_t LOS_CACHE_MAX      = 2000;     ///< maximum number of cached results, cache is flushed when reached
+/// per-frame time budget for terrain probes
+constexpr std::chrono::microseconds LOS_FRAME_BUDGET(250);
+
+/// Result of a line-of-sight check
+enum LOSResultTy {
+    LOS_UNKNOWN = 0,            ///< not (yet) known, a check might be under way
+    LOS_CLEAR,                  ///< no terrain found between plane and station
+    LOS_BLOCKED,                ///< terrain masks the station
+};
+
+/// @brief Performs terrain line-of-sight checks within a per-frame time budget
+/// @details Terrain probes must be called from X-Plane's main thread and
+///          each of them takes a few microseconds. A path of 100nm requires
+///          about 100 samples. So instead of probing a complete path at once
+///          we queue a check and process it sample by sample from a
+///          flight loop callback until the frame's budget is used up.
+///          Results are cached per grid cell of the plane's position,
+///          so that they don't need to be recomputed while the plane
+///          stays in the same cell.
+class LOSCheckerTy
+{
+protected:
+    /// Cache key: plane's grid cell plus station
+    struct CellKeyTy {
+        int latIdx = 0, lonIdx = 0, altIdx = 0;
+        std::string icao;
+        bool operator< (const CellKeyTy& o) const
+        { return std::tie(latIdx, lonIdx, altIdx, icao) < std::tie(o.latIdx, o.lonIdx, o.altIdx, o.icao); }
+    };
+    
+    /// A check in progress
+    struct JobTy {
+        CellKeyTy key;              ///< where to store the result
+        positionTy from, to;        ///< plane's and station's antenna position
+        vectorTy vec;               ///< vector from `from` to `to`
+        int nSamples = 0;           ///< total number of samples along the path
+        int nextSample = 1;         ///< next sample to probe
+        int nFrames = 0;            ///< number of frames worked on this job
+        std::chrono::microseconds tTotal{0}; ///< total time spent on this job
+        std::chrono::microseconds tMaxSlice{0}; ///< maximum time spent per frame
+    };
+    
+    std::map<CellKeyTy,LOSResultTy> mapCache;   ///< cached results
+    std::deque<JobTy> jobs;                     ///< pending checks
+    bool bWorking = false;                      ///< is DoWork() probing a job taken out of `jobs`?
+    CellKeyTy workKey;                          ///< key of the job DoWork() is probing
+    XPLMProbeRef probeRef = nullptr;            ///< terrain probe, only used from the main thread
+    mutable std::mutex mtx;                     ///< guards cache, jobs, and work key as queries can come from other threads
+
+public:
+    /// Destructor destroys the probe
+    ~LOSCheckerTy();
+    
+    /// @brief Return the (cached) line-of-sight from plane to station
+    /// @details If there is no cached result yet a check is queued
+    ///          and LOS_UNKNOWN returned.
+    /// @param icao Station's airport id, used as cache key
+    /// @param planePos Plane's position incl. altitude
+    /// @param stationPos Station's position incl. elevation
+    LOSResultTy Query (const std::string& icao,
+                       const positionTy& planePos,
+                       const positionTy& stationPos);
+    
+    /// @brief Works on pending checks till `budget` is used up
+    /// @warning Must be called from X-Plane's main thread
+    /// @return Is there more work pending?
+    bool DoWork (std::chrono::microseconds budget);
+    
+    /// Any checks pending?
+    bool HasWork () const;
+    
+    /// Removes all cached results and pending jobs
+    void Clear ();
+    
+protected:
+    /// Compute the plane's cache cell
+    static CellKeyTy MakeKey (const std::string& icao, const positionTy& planePos);
+    /// Probes the next sample of `job`, returns a final result if any
+    LOSResultTy ProbeNextSample (JobTy& job);
+};
+
+/// The global line-of-sight checker
+extern LOSCheckerTy gLOS;
+
+/// Start the per-frame flight loop callback working on line-of-sight checks
+void LOSStart ();
+/// Stop the flight loop callback and clear all results
+void LOSStop ();
+
+#endif /* PLALineOfSight_h */
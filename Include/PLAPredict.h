@@ -0,0 +1,118 @@
+//
+//  PLAPredict.h
+//  PlayLiveATC
+//
+// Flight phase detection and prediction of the next facility to be tuned
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAPredict_h
+#define PLAPredict_h
+
+#define DBG_PHASE_CHANGE    "Flight phase: %s -> %s"
+
+// Flight phase detection thresholds
+constexpr double PHASE_PARKED_KN    = 2.0;      ///< [kn] below that speed on the ground we consider the plane parked
+constexpr int    PHASE_PARKED_HOLD_S = 60;      ///< [s] after landing the plane must stand still that long to be considered parked
+constexpr double PHASE_TAXI_KN      = 40.0;     ///< [kn] above that speed on the ground we consider the plane taking off or landing
+constexpr double PHASE_CLIMB_FPM    = 300.0;    ///< [ft/min] vertical speed above which we consider the plane climbing
+constexpr double PHASE_APPROACH_KN  = 200.0;    ///< [kn] descending below that speed is considered approach
+constexpr double PHASE_VSI_SMOOTH   = 0.3;      ///< [-] weight of a new vertical speed sample (exponential smoothing)
+
+/// Flight phases as far as they matter for radio usage
+enum FlightPhaseTy {
+    PHASE_UNKNOWN = 0,          ///< not yet determined
+    PHASE_PARKED,               ///< on the ground, not moving
+    PHASE_TAXI_OUT,             ///< taxiing before takeoff
+    PHASE_TAKEOFF,              ///< takeoff roll
+    PHASE_CLIMB,                ///< airborne, climbing
+    PHASE_CRUISE,               ///< airborne, level
+    PHASE_DESCENT,              ///< airborne, descending at high speed
+    PHASE_APPROACH,             ///< airborne, descending at lower speed
+    PHASE_LANDING,              ///< landing roll
+    PHASE_TAXI_IN,              ///< taxiing after landing
+};
+
+/// Flight phase as text
+const char* GetPhaseStr (FlightPhaseTy phase);
+
+/// ATC facility types, as bit flags as a stream can serve several facilities
+enum FacilityTy : unsigned {
+    FAC_NONE        = 0x00,
+    FAC_DELIVERY    = 0x01,     ///< Clearance Delivery
+    FAC_GROUND      = 0x02,     ///< Ground
+    FAC_TOWER       = 0x04,     ///< Tower
+    FAC_DEPARTURE   = 0x08,     ///< Departure
+    FAC_APPROACH    = 0x10,     ///< Approach, Arrival, Final
+    FAC_CENTER      = 0x20,     ///< Center, Control
+    FAC_ATIS        = 0x40,     ///< ATIS
+};
+
+/// @brief Facilities a stream serves, judged by keywords in its name
+/// @param streamName Stream name like "KSFO Ground/Tower"
+/// @return Bit set of `FacilityTy`
+unsigned GetFacilities (const std::string& streamName);
+
+/// A facility together with the likelihood it is tuned next
+typedef std::pair<FacilityTy,double> FacilityLikelihoodTy;
+
+/// @brief Ranks the facilities likely to be tuned next
+/// @details Follows the typical sequence Delivery -> Ground -> Tower ->
+///          Departure -> Center -> Approach -> Tower -> Ground,
+///          starting from what is tuned now and taking the flight phase
+///          into account.
+/// @param phase Current flight phase
+/// @param currFac Facilities served by the currently tuned stream
+/// @return Facilities, most likely first; facilities of `currFac` are not included
+std::vector<FacilityLikelihoodTy> PredictNextFacilities (FlightPhaseTy phase, unsigned currFac);
+
+/// @brief Detects the flight phase from the user's plane's state
+/// @details Updated once a second from the flight loop,
+///          the phase is then passed to the channels with their input.
+class FlightPhaseDetectorTy
+{
+protected:
+    FlightPhaseTy phase = PHASE_UNKNOWN;    ///< current phase
+    bool bFlown = false;                    ///< airborne since the plane was last parked?
+    double lastElev_m = NAN;                ///< elevation at last update
+    double vsi_fpm = 0.0;                   ///< smoothed vertical speed
+    /// since when is the plane standing still on the ground, or zero if it is not
+    std::chrono::time_point<std::chrono::steady_clock> tStopped;
+    /// time of last update
+    std::chrono::time_point<std::chrono::steady_clock> tLast;
+
+public:
+    /// @brief Determine the flight phase anew
+    /// @warning Must be called from X-Plane's main thread
+    void Update ();
+    /// Current flight phase
+    FlightPhaseTy GetPhase () const { return phase; }
+    /// Forget all history, e.g. after a new flight has been loaded
+    void Reset ();
+};
+
+/// The global flight phase detector
+extern FlightPhaseDetectorTy gPhase;
+
+#endif /* PLAPredict_h */
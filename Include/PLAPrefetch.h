@@ -0,0 +1,125 @@
+//
+//  PLAPrefetch.h
+//  PlayLiveATC
+//
+// Prefetches LiveATC streams for the airports of the loaded flight plan
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAPrefetch_h
+#define PLAPrefetch_h
+
+#define LIVE_ATC_AP_URL     LIVE_ATC_BASE "/search/?icao=%s"
+
+#define MSG_PREFETCH_START  "Airport prefetch: Fetching streams for %s"
+#define MSG_PREFETCH_DONE   "Airport prefetch: %d streams on %d frequencies, %d frequency searches, %d stream URLs resolved in %.1fs"
+#define DBG_PREFETCH_HIT    "Airport prefetch: Using streams prefetched for %s"
+#define DBG_PREFETCH_SEARCH "Airport prefetch: Using the search prefetched for %s"
+
+constexpr int PREFETCH_MAX_AIRPORTS = 6;        ///< max number of flight plan airports to prefetch
+constexpr int PREFETCH_MAX_AGE_S    = 30 * 60;  ///< [s] prefetched data is considered outdated thereafter
+
+/// @brief Prefetches LiveATC streams for the airports of the loaded flight plan
+///        and the airports currently tuned to
+/// @details Reads the airports from X-Plane's FMS and the channels' status (main thread only)
+///          and then, in a worker task, queries LiveATC for all
+///          streams of these airports, collects them per frequency,
+///          and resolves their `.pls` playlists. For each frequency found
+///          it also fetches LiveATC's frequency search, which lists
+///          all airports sharing that frequency. When the pilot later tunes
+///          one of these frequencies the stream can be started without
+///          going online for the search or the playlist first.
+///          The prefetched streams also serve as fallback if LiveATC's
+///          frequency search fails.
+class FeedPrefetchTy
+{
+protected:
+    /// prefetched streams per frequency (format ###.###), each a map per airport
+    std::map<std::string,LiveATCDataMapTy> mapFrequ;
+    /// prefetched LiveATC frequency search pages per frequency (format ###.###)
+    std::map<std::string,std::string> mapSearch;
+    /// A resolved `.pls` playlist
+    struct PlsTy {
+        std::string url;                                        ///< stream URL
+        std::chrono::time_point<std::chrono::steady_clock> t;   ///< when resolved
+    };
+    /// resolved `.pls` playlist URLs: playlist URL -> stream URL, outdated after `PREFETCH_MAX_AGE_S`
+    std::map<std::string,PlsTy> mapPls;
+    /// when were `mapFrequ` and `mapSearch` fetched?
+    std::chrono::time_point<std::chrono::steady_clock> tFetched;
+    /// guards the above as they are accessed from several threads
+    mutable std::mutex mtx;
+    
+    /// airports last prefetched (main thread only)
+    std::vector<std::string> vPlanAirports;
+    /// make the background fetch stop early
+    std::atomic<bool> bAbort{false};
+
+public:
+    /// @brief Checks the flight plan and tuned airports for changes and starts prefetching if so
+    /// @warning Must be called from X-Plane's main thread
+    void CheckAirports ();
+    
+    /// @brief Returns the streams prefetched for a frequency
+    /// @param frequ Frequency in the format ###.###
+    /// @param[out] mapAp Receives the prefetched streams per airport
+    /// @return Found any prefetched stream for that frequency?
+    bool LookupFrequ (const std::string& frequ, LiveATCDataMapTy& mapAp) const;
+    
+    /// @brief Returns LiveATC's frequency search page as prefetched
+    /// @param frequ Frequency in the format ###.###
+    /// @param[out] page Receives the search result page, as `HttpGet()` would for `LIVE_ATC_URL`
+    /// @return Is a recent enough search page available?
+    bool LookupSearch (const std::string& frequ, std::string& page) const;
+    
+    /// @brief Returns all streams prefetched for an airport
+    /// @param icao Airport
+    /// @param[out] vFeeds Receives the streams together with their frequency in XP's format
+    /// @return Found any prefetched stream for that airport?
+    bool LookupAirport (const std::string& icao,
+                        std::vector<std::pair<int,LiveATCDataTy>>& vFeeds) const;
+    
+    /// @brief Resolves a `.pls` playlist URL into the stream URL, uses cached results
+    /// @param plsUrl The playlist URL
+    /// @param[out] url Receives the stream URL, empty if playlist could be read but not parsed
+    /// @return `false` if the playlist could not be fetched
+    bool ResolvePls (const std::string& plsUrl, std::string& url);
+    
+    /// Stops a running background fetch (blocking) and clears all prefetched data
+    void Stop ();
+    
+protected:
+    /// Reads the flight plan's airports from the FMS
+    static std::vector<std::string> ReadFlightPlanAirports ();
+    /// @brief Worker task: fetches all streams of the given airports
+    /// @param vAirports Airports together with their positions
+    void Fetch (std::vector<std::pair<std::string,positionTy>> vAirports);
+    /// Is the background fetch queued or running?
+    bool IsFetching () const;
+};
+
+/// The global flight plan prefetcher
+extern FeedPrefetchTy gPrefetch;
+
+#endif /* PLAPrefetch_h */
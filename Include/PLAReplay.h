@@ -0,0 +1,120 @@
+//
+//  PLAReplay.h
+//  PlayLiveATC
+//
+// "Say again": Per channel history of received audio in a memory-mapped
+// ring file, and the index of transmissions to replay the last one from
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAReplay_h
+#define PLAReplay_h
+
+#define DBG_REPLAY_OPEN     "Replay: Keeping %d minutes of received audio in '%s'"
+#define ERR_REPLAY_OPEN     "Replay: Could not map ring file '%s': %s"
+#define WARN_REPLAY_DROPPED "Replay: %lu frames dropped, they were not stored in time"
+
+constexpr size_t    REPLAY_FRAME_SAMPLES = AUDIO_BUF_FRAMES; ///< one frame is one mixer buffer, stored as that many mu-law bytes
+/// frames queued between mixer and executor, covers the longest flight loop interval plus a tick
+constexpr size_t    REPLAY_QUEUE_FRAMES = size_t(PLA_LOOP_IDLE * 1000.0f + PLA_TICK_MS) / AUDIO_BUF_MS + 1;
+constexpr size_t    REPLAY_TX_MAX       = 64;       ///< number of transmissions kept in the index
+constexpr uint64_t  REPLAY_SAFETY_FRAMES = 20;      ///< frames kept clear of the writer while reading
+
+/// One transmission, i.e. a period of signal, in the ring
+struct ReplayTxTy {
+    uint64_t startFrame = 0;    ///< first frame of the transmission
+    uint64_t endFrame = 0;      ///< frame after the transmission, 0 while still receiving
+    std::chrono::time_point<std::chrono::steady_clock> tStart;  ///< when it started
+};
+
+/// One frame as handed over from the mixer
+struct ReplayFrameTy {
+    std::array<float,REPLAY_FRAME_SAMPLES> samples; ///< the frame's samples as played
+    bool bSignal = false;                           ///< is there a signal, i.e. someone talking?
+    std::chrono::time_point<std::chrono::steady_clock> t;  ///< when the frame was played
+};
+
+/// @brief History of one channel's received audio, in a memory-mapped ring file
+/// @details Only frames with a signal are recorded, so the history covers
+///          the last minutes of actual radio traffic. Frames are mu-law
+///          encoded and written sequentially into the mapped file, so RAM
+///          use is just the pages the OS keeps mapped, independent of the
+///          history's length. The mixer only queues frames, so that
+///          encoding and page faults of the mapping stay off the sim thread.
+///          The channel's executor stores the queued frames, see Store(),
+///          and reads.
+class ReplayRingTy
+{
+protected:
+    std::string path;                   ///< path of the ring file
+    uint8_t* pMap = nullptr;            ///< mapped ring file
+    uint64_t nFrames = 0;               ///< ring capacity in frames
+#if IBM
+    HANDLE hFile = INVALID_HANDLE_VALUE;    ///< ring file
+    HANDLE hMap = NULL;                 ///< file mapping
+#else
+    int fd = -1;                        ///< ring file
+#endif
+    uint64_t wrFrame = 0;               ///< number of frames written so far
+    bool bInTx = false;                 ///< executor: currently receiving a transmission?
+    std::array<ReplayTxTy,REPLAY_TX_MAX> txs;   ///< transmission `i` is stored at `i % REPLAY_TX_MAX`
+    size_t nTx = 0;                     ///< number of transmissions started so far
+    bool bQueuedTx = false;             ///< mixer: was the last queued frame a signal?
+    SPSCQueueTy<ReplayFrameTy,REPLAY_QUEUE_FRAMES> queue;   ///< frames from the mixer to the executor
+    std::atomic<unsigned long> cntDropped{0};   ///< frames lost as the queue was full
+    
+public:
+    /// Closed ring
+    ReplayRingTy () {}
+    /// Owns the mapping, not to be copied
+    ReplayRingTy (const ReplayRingTy&) = delete;
+    /// Unmaps and closes the file
+    ~ReplayRingTy () { Close(); }
+    
+    /// @brief Create (or reuse) the ring file of a fixed size and map it
+    /// @param filePath Path of the ring file
+    /// @param minutes [min] length of history to keep
+    bool Open (const std::string& filePath, int minutes);
+    /// Unmap and close the file
+    void Close ();
+    /// Is the ring file mapped?
+    bool IsOpen () const { return pMap != nullptr; }
+    
+    /// @brief Mixer: queue one frame as played
+    /// @param samples `REPLAY_FRAME_SAMPLES` samples
+    /// @param bSignal Is there a signal, i.e. someone talking?
+    void Record (const float* samples, bool bSignal);
+    
+    /// Executor: encode queued frames into the ring file
+    void Store ();
+    
+    /// @brief Executor: the last complete transmission, still available in the ring
+    /// @param[out] samples Decoded samples of the transmission
+    /// @param[out] tStart When the transmission started
+    /// @return Is there a transmission to replay?
+    bool GetLastTx (std::vector<float>& samples,
+                    std::chrono::time_point<std::chrono::steady_clock>& tStart) const;
+};
+
+#endif /* PLAReplay_h */
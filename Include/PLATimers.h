@@ -0,0 +1,132 @@
+//
+//  PLATimers.h
+//  PlayLiveATC
+//
+// Hierarchical timer wheel for periodic and one-shot jobs,
+// advanced by the flight loop
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLATimers_h
+#define PLATimers_h
+
+#define DBG_TIMERS_STATS    "Timers: %lu jobs fired, at most %lu in one flight loop call"
+
+constexpr int TIMER_RES_MS      = 100;      ///< [ms] resolution of the timer wheel
+constexpr unsigned TIMER_SLOTS  = 64;       ///< slots per level, level 0 spans 6.4s, level 1 spans about 7 minutes
+
+/// Identifies a job in the timer wheel, 0 is no job
+typedef unsigned long TimerIdTy;
+
+/// @brief Hierarchical timer wheel with two levels
+/// @details Jobs are registered once and then started, restarted, or stopped
+///          as needed. Level 0 holds jobs due within the next
+///          `TIMER_SLOTS` ticks, level 1 holds later jobs, which are moved
+///          down to level 0 when their round begins. Jobs even further out
+///          are just moved along in level 1.
+///          Restarting or stopping a job does not search the wheel:
+///          Entries in the slots carry the job's generation they were
+///          inserted with, which every (re)start and stop increments,
+///          and are ignored if that doesn't match the job any longer.
+///
+///          Advance() is called from the flight loop and executes due jobs
+///          right there. Jobs shall therefore be quick, typically they
+///          just post a task to the worker pool.
+///          All other functions can be called from any thread.
+class TimerWheelTy
+{
+protected:
+    /// A registered job
+    struct JobTy {
+        unsigned long due = 0;          ///< tick when due, 0 if not started
+        unsigned long period = 0;       ///< [ticks] period of a periodic job, 0 for one-shot
+        unsigned long gen = 0;          ///< generation, incremented with every (re)start or stop
+        int chn = -1;                   ///< channel the job belongs to
+        std::function<void()> fn;       ///< what to do
+    };
+    /// An entry in a slot
+    struct SlotEntryTy {
+        TimerIdTy id = 0;               ///< the job
+        unsigned long gen = 0;          ///< job's generation when inserted, stale if no longer matching
+        unsigned long due = 0;          ///< tick the entry was inserted for
+    };
+    /// A slot holds the entries of all jobs due in one tick (level 0) or one round (level 1)
+    typedef std::vector<SlotEntryTy> SlotTy;
+    
+    std::map<TimerIdTy,JobTy> jobs;             ///< all registered jobs
+    std::array<SlotTy,TIMER_SLOTS> wheel0;      ///< level 0, one slot per tick
+    std::array<SlotTy,TIMER_SLOTS> wheel1;      ///< level 1, one slot per round of level 0
+    std::chrono::steady_clock::time_point tStart;   ///< when tick 0 was
+    unsigned long currTick = 1;                 ///< next tick to process
+    TimerIdTy nextId = 1;                       ///< next job id to hand out
+    unsigned long cntFired = 0;                 ///< statistics: jobs executed
+    unsigned long maxFired = 0;                 ///< statistics: max jobs executed in one call to Advance()
+    mutable std::mutex mtx;                     ///< guards all of the above
+    
+public:
+    /// Constructor sets tick 0 to now
+    TimerWheelTy () : tStart(std::chrono::steady_clock::now()) {}
+    
+    /// @brief Register a job, which is not yet started
+    /// @param chn Channel the job belongs to, or `WORK_NO_CHN`
+    /// @param fn What to do, executed in the flight loop
+    /// @return Job id to be used for starting, stopping, removing the job
+    TimerIdTy Add (int chn, std::function<void()> fn);
+    
+    /// @brief (Re)Start a job, replaces any earlier due time
+    /// @param id Job id as returned by Add()
+    /// @param delayMs [ms] First execution after that time
+    /// @param periodMs [ms] Period for repeated execution, 0 for one-shot
+    /// @return `false` if job is unknown
+    bool Start (TimerIdTy id, int delayMs, int periodMs = 0);
+    
+    /// Stop a job, it stays registered
+    void Stop (TimerIdTy id);
+    /// Stop all jobs of a channel
+    void StopChn (int chn);
+    /// Remove a job
+    void Remove (TimerIdTy id);
+    /// Remove all jobs of a channel
+    void RemoveChn (int chn);
+    /// Remove all jobs, logs statistics
+    void Clear ();
+    
+    /// @brief Execute all jobs due by now
+    /// @warning Jobs are executed in the calling thread, meant to be the flight loop
+    /// @return Number of jobs executed
+    unsigned long Advance ();
+    
+protected:
+    /// Put a job into the wheel according to its due tick, expects the lock
+    void Insert (const SlotEntryTy& e);
+    /// Is the entry still current for its job? Expects the lock
+    bool IsCurrent (const SlotEntryTy& e) const;
+    /// Move level 1's entries of the round starting with `currTick` down to level 0, expects the lock
+    void Cascade ();
+};
+
+/// The global timer wheel
+extern TimerWheelTy gTimers;
+
+#endif /* PLATimers_h */
@@ -0,0 +1,204 @@
+//
+//  PLAWorkers.h
+//  PlayLiveATC
+//
+// Small fixed pool of worker threads executing stream control tasks
+// by priority
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAWorkers_h
+#define PLAWorkers_h
+
+#define DBG_WORKERS_START   "Started %d worker threads"
+#define DBG_WORKERS_STOP    "Stopped worker threads, %lu tasks done, %lu cancelled"
+
+constexpr int WORK_NO_CHN    = -1;          ///< channel index for tasks not related to any COM channel
+
+/// Priority of a task, the higher the more urgent
+enum WorkPrioTy {
+    WORK_PREFETCH = 0,          ///< speculative prefetch
+    WORK_STANDBY,               ///< pre-buffering of the stand-by frequency
+    WORK_AP_SWITCH,             ///< switch to a closer airport on the active frequency
+    WORK_TUNE,                  ///< tuning the active frequency
+    WORK_CONTROL,               ///< processing a channel's commands, quick
+};
+
+/// @brief Small fixed pool of worker threads executing tasks by priority
+/// @details Tasks are queued with a priority and a channel index.
+///          Workers always pick the most urgent task (oldest first among
+///          same priority), but never run two tasks of the same channel
+///          at the same time, so tasks of one channel are executed
+///          one after the other. Posting never blocks beyond a short lock;
+///          queued tasks can be cancelled by channel.
+class WorkerPoolTy
+{
+protected:
+    /// A queued task
+    struct TaskTy {
+        WorkPrioTy prio = WORK_PREFETCH;    ///< priority
+        unsigned long seq = 0;              ///< sequence number, keeps order among same priority
+        int chn = WORK_NO_CHN;              ///< channel the task belongs to
+        std::function<void()> fn;           ///< the work to do
+    };
+    
+    std::vector<std::thread> threads;       ///< the worker threads
+    std::list<TaskTy> tasks;                ///< queued tasks, typically just a few
+    /// channels with a task being executed right now, and that task's priority
+    std::vector<std::pair<int,WorkPrioTy>> busyChn;
+    unsigned long nextSeq = 0;              ///< next sequence number
+    unsigned long cntDone = 0;              ///< statistics: tasks executed
+    unsigned long cntCancelled = 0;         ///< statistics: tasks cancelled before execution
+    bool bStop = false;                     ///< shall workers stop?
+    mutable std::mutex mtx;                 ///< guards all of the above
+    std::condition_variable cv;             ///< signals any change of tasks or busy channels
+
+public:
+    /// Start `n` worker threads, typically one per channel plus one for prefetching
+    void Start (int n);
+    /// Stop all worker threads, waits for running tasks, drops queued ones
+    void Stop ();
+    /// Number of worker threads running
+    int GetThreadCnt () const { return (int)threads.size(); }
+    
+    /// @brief Queue a task
+    /// @param prio Priority of the task
+    /// @param chn Channel the task belongs to, or WORK_NO_CHN
+    /// @param fn The work to do
+    void Post (WorkPrioTy prio, int chn, std::function<void()> fn);
+    
+    /// @brief Remove queued tasks of a channel
+    /// @param chn Channel
+    /// @param maxPrio Only tasks up to this priority are removed
+    /// @return Number of removed tasks
+    int Cancel (int chn, WorkPrioTy maxPrio = WORK_TUNE);
+    
+    /// @brief Is a task of this channel queued or running?
+    /// @param chn Channel
+    /// @param maxPrio Only consider tasks up to this priority
+    bool IsBusy (int chn, WorkPrioTy maxPrio = WORK_CONTROL) const;
+    
+    /// @brief Wait till no task of this channel is queued or running
+    /// @warning Blocks! Not to be called from the flight loop
+    void WaitIdle (int chn);
+
+protected:
+    /// Worker thread's main loop
+    void Run ();
+    /// Find the most urgent task whose channel is not busy
+    std::list<TaskTy>::iterator NextTask ();
+    /// Is a task of this channel being executed?
+    bool IsRunning (int chn, WorkPrioTy maxPrio = WORK_CONTROL) const
+    { return std::any_of(busyChn.cbegin(), busyChn.cend(),
+                         [chn,maxPrio](const std::pair<int,WorkPrioTy>& b)
+                         { return b.first == chn && b.second <= maxPrio; }); }
+};
+
+/// The global worker pool
+extern WorkerPoolTy gWorkers;
+
+/// @brief Lock-free single-producer/single-consumer ring buffer
+/// @details One thread pushes, one thread at a time pops.
+///          Holds up to `N-1` elements.
+template <class T, size_t N>
+class SPSCQueueTy
+{
+protected:
+    std::array<T,N> ring;               ///< the elements
+    std::atomic<size_t> head{0};        ///< next element to pop, written by consumer only
+    std::atomic<size_t> tail{0};        ///< next slot to push to, written by producer only
+    
+public:
+    /// Add an element, returns `false` if the queue is full
+    bool Push (T&& v)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t next = (t + 1) % N;
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+        ring[t] = std::move(v);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+    
+    /// Remove the oldest element, returns `false` if the queue is empty
+    bool Pop (T& v)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        v = std::move(ring[h]);
+        head.store((h + 1) % N, std::memory_order_release);
+        return true;
+    }
+    
+    /// Is the queue full? (Reliable for the producer only)
+    bool Full () const
+    { return (tail.load(std::memory_order_relaxed) + 1) % N == head.load(std::memory_order_acquire); }
+    
+    /// Is the queue empty?
+    bool Empty () const
+    { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+};
+
+/// @brief Single-writer sequence lock for trivially copyable data
+/// @details The writer never waits. Readers never lock nor allocate,
+///          they just copy the data and retry in the rare case
+///          the writer was updating it at the same time.
+template <class T>
+class SeqLockTy
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLockTy requires trivially copyable data");
+protected:
+    std::atomic<unsigned> seq{0};       ///< odd while writing
+    T data;                             ///< the protected data
+    
+public:
+    /// Publish new data, only one writer at a time
+    void Write (const T& v)
+    {
+        const unsigned s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&data, &v, sizeof(T));
+        seq.store(s + 2, std::memory_order_release);
+    }
+    
+    /// Read a consistent copy of the data, wait-free for all practical purposes
+    T Read () const
+    {
+        T v;
+        unsigned s1 = 0, s2 = 0;
+        do {
+            s1 = seq.load(std::memory_order_acquire);
+            std::memcpy(&v, &data, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = seq.load(std::memory_order_relaxed);
+        } while ((s1 & 1) || s1 != s2);
+        return v;
+    }
+};
+
+#endif /* PLAWorkers_h */
@@ -43,11 +43,22 @@
 // Standard C++
 #include <string>
 #include <list>
+#include <deque>
 #include <vector>
+#include <array>
 #include <map>
+#include <set>
+#include <tuple>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
 #include <chrono>
 #include <fstream>
 #include <future>
+#include <thread>
+#include <functional>
+#include <condition_variable>
 #include <regex>
 
 // Windows
@@ -68,6 +79,15 @@
 #include <GL/gl.h>
 #endif
 
+// Open AL
+#if APL
+#include <OpenAL/al.h>
+#include <OpenAL/alc.h>
+#else
+#include <AL/al.h>
+#include <AL/alc.h>
+#endif
+
 // CURL
 // #define CURL_STATICLIB if linking with a static CURL lib!
 #include "curl/curl.h"              // for CURL*
@@ -100,12 +120,21 @@
 #include "TextIO.h"
 #include "DataRefs.h"
 #include "SettingsUI.h"
+#include "PLALineOfSight.h"
+#include "PLAAirports.h"
+#include "PLAWorkers.h"
+#include "PLATimers.h"
+#include "PLAAudio.h"
+#include "PLAReplay.h"
+#include "PLAPredict.h"
 #include "PLACOMChannel.h"
+#include "PLAPrefetch.h"
 
 // Global variables
 extern DataRefs dataRefs;           // in PlayLiveATC.cpp
 
 // Global functions
 bool InitFullVersion ();
+void VLCInitDone ();                // in PlayLiveATC.cpp
 
 #endif /* PlayLiveATC_h */
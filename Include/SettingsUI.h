@@ -44,7 +44,7 @@ protected:
     TFWidget subBasics, subAdvcd;
     
     // Basics tab
-    TFButtonWidget btnBasicsCom[COM_CNT]; // toggle act on COM1/2
+    TFButtonWidget btnBasicsCom[COM_CNT_XP]; // toggle act on COM1/2
     TFButtonWidget btnPlayIfSelected;
     TFTextFieldWidget txtVolume;
     TFButtonWidget btnMute;
@@ -68,6 +68,9 @@ protected:
     TFButtonWidget btnKeepPrevWhileDesync;
     TFButtonWidget btnPreBufferStandbyFrequ;
     TFTextFieldWidget txtMaxRadioDist;
+    TFButtonWidget btnRadioHorizon;
+    TFButtonWidget btnTerrainLOS;
+    TFButtonWidget btnPrefetchFPlan;
 
 public:
     LTSettingsUI();
@@ -104,9 +104,21 @@ positionTy CoordPlusVector (const positionTy& p, const vectorTy& vec)
     return ret.rad2deg();
 }
 
+// radio horizon [m] between two antennas at the given heights [m]
+// Each antenna sees sqrt(2*k*R*h) far, with R the earth radius and
+// k accounting for the refraction of VHF waves in a standard atmosphere
+double RadioHorizon_m (double h1_m, double h2_m)
+{
+    if (h1_m < 0) h1_m = 0;
+    if (h2_m < 0) h2_m = 0;
+    return std::sqrt(RADIO_K_FACTOR * EARTH_D_M * h1_m) +
+           std::sqrt(RADIO_K_FACTOR * EARTH_D_M * h2_m);
+}
+
 // returns terrain altitude at given position
 // returns NaN in case of failure
-double YProbe_at_m (const positionTy& posAt, XPLMProbeRef& probeRef)
+double YProbe_at_m (const positionTy& posAt, XPLMProbeRef& probeRef,
+                    bool bLogErr)
 {
     // first call, don't have handle?
     if (!probeRef)
@@ -128,7 +140,10 @@ double YProbe_at_m (const positionTy& posAt, XPLMProbeRef& probeRef)
                                               (float)pos.Z(),
                                               &probeInfo);
     if (res != xplm_ProbeHitTerrain)
-    {LOG_MSG(logERR,ERR_Y_PROBE,int(res),posAt.dbgTxt().c_str()); return NAN;}
+    {
+        if (bLogErr) LOG_MSG(logERR,ERR_Y_PROBE,int(res),posAt.dbgTxt().c_str());
+        return NAN;
+    }
     
     // convert to World coordinates and save terrain altitude [in ft]
     pos = positionTy(probeInfo);
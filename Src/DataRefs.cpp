@@ -31,12 +31,6 @@
 //
 const char* DATA_REFS_XP[] = {
     // XP standard
-    "sim/cockpit2/radios/actuators/com1_frequency_hz_833",          // int    y    hertz    Com radio 1 frequency, hz, supports 8.3 khz spacing
-    "sim/cockpit2/radios/actuators/com2_frequency_hz_833",          // int    y    hertz    Com radio 2 frequency, hz, supports 8.3 khz spacing
-    "sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833",  // int    y    hertz    Com radio 1 standby frequency, hz, supports 8.3 khz spacing
-    "sim/cockpit2/radios/actuators/com2_standby_frequency_hz_833",  // int    y    hertz    Com radio 2 standby frequency, hz, supports 8.3 khz spacing
-    "sim/cockpit2/radios/actuators/audio_selection_com1",           // int    y    boolean    is com1 selected for listening
-    "sim/cockpit2/radios/actuators/audio_selection_com2",           // int    y    boolean    is com2 selected for listening
     "sim/flightmodel/position/latitude",                            // user's plane's position
     "sim/flightmodel/position/longitude",
     "sim/flightmodel/position/elevation",
@@ -49,6 +43,7 @@ const char* DATA_REFS_XP[] = {
     // X-Plane 11 only
     "sim/atc/atis_enabled",                                 // int    y    boolean    Is the ATIS system enabled? If not, no ATIS text or audio will appear even when tuned to a proper frequency."
     "sim/graphics/VR/enabled",                              // int    n    Boolean    True if VR is enabled, false if it is disabled
+    "sim/cockpit2/radios/actuators/audio_com_selection",    // int    y    enum    6=com1,7=com2 - this is the radio that the mic is selected to
     // LiveTraffic
     "livetraffic/cfg/aircrafts_displayed",
     "livetraffic/cfg/fd_buf_period",
@@ -66,11 +61,104 @@ struct cmdRefDescrTy {
 } CMD_REFS_PLA[] = {
     {"PlayLiveATC/Monitor_COM1", "Monitor COM1 frequency change"},
     {"PlayLiveATC/Monitor_COM2", "Monitor COM2 frequency change"},
+    {"PlayLiveATC/Say_Again_COM1", "Replay the last transmission received on COM1"},
+    {"PlayLiveATC/Say_Again_COM2", "Replay the last transmission received on COM2"},
 };
 
 static_assert(sizeof(CMD_REFS_PLA) / sizeof(CMD_REFS_PLA[0]) == CNT_CMDREFS_PLA,
               "cmdRefsLT and CMD_REFS_LT[] differ in number of elements");
 
+//
+// MARK: Channel Bindings
+//
+
+// Binding to one of X-Plane's COM radios
+ComBindingTy::ComBindingTy (int comNr)
+{
+    char buf[100];
+    snprintf(buf, sizeof(buf), DR_XP_RADIO_COM_FREQ, comNr);
+    drFrequ = buf;
+    snprintf(buf, sizeof(buf), DR_XP_RADIO_COM_STANDBY, comNr);
+    drStandby = buf;
+    snprintf(buf, sizeof(buf), DR_XP_RADIO_COM_SEL, comNr);
+    drSel = buf;
+}
+
+// Active frequency, 0 if not available
+int ComBindingTy::GetFrequ () const
+{
+    if (fixedFrequ > 0)
+        return fixedFrequ;
+    Bind();
+    return adrFrequ ? XPLMGetDatai(adrFrequ) : 0;
+}
+
+// Stand-by frequency, 0 if not available
+int ComBindingTy::GetStandbyFrequ () const
+{
+    Bind();
+    return adrStandby ? XPLMGetDatai(adrStandby) : 0;
+}
+
+// Is the radio selected for listening?
+bool ComBindingTy::IsSelected () const
+{
+    Bind();
+    return adrSel ? XPLMGetDatai(adrSel) != 0 : true;
+}
+
+// Set the definition from a config file entry
+bool ComBindingTy::SetFromCfg (const std::string& s)
+{
+    *this = ComBindingTy();
+    const std::vector<std::string> tok = str_tokenize(s, " ");
+    if (tok.empty())
+        return false;
+    
+    // first token: fixed frequency (only digits) or frequency dataref
+    if (tok[0].find_first_not_of("0123456789") == std::string::npos) {
+        // out of range is as bad as no frequency at all
+        try { fixedFrequ = std::stoi(tok[0]); }
+        catch (...) { return false; }
+    }
+    else
+        drFrequ = tok[0];
+    // optional stand-by and selection datarefs
+    if (tok.size() >= 2 && tok[1] != "-")
+        drStandby = tok[1];
+    if (tok.size() >= 3 && tok[2] != "-")
+        drSel = tok[2];
+    return IsDefined();
+}
+
+// The definition in config file format
+std::string ComBindingTy::GetCfgString () const
+{
+    std::string s = fixedFrequ > 0 ? std::to_string(fixedFrequ) : drFrequ;
+    if (!drStandby.empty() || !drSel.empty())
+        s += ' ' + (drStandby.empty() ? std::string("-") : drStandby);
+    if (!drSel.empty())
+        s += ' ' + drSel;
+    return s;
+}
+
+// Lookup the datarefs, if not done yet
+void ComBindingTy::Bind () const
+{
+    if (bBound)
+        return;
+    bBound = true;
+    for (auto p: { std::make_pair(&drFrequ,   &adrFrequ),
+                   std::make_pair(&drStandby, &adrStandby),
+                   std::make_pair(&drSel,     &adrSel) })
+    {
+        if (p.first->empty())
+            continue;
+        if ((*p.second = XPLMFindDataRef(p.first->c_str())) == NULL)
+            LOG_MSG(logWARN, ERR_DATAREF_FIND, p.first->c_str());
+    }
+}
+
 //
 //MARK: Constructor - just plain variable init, no API calls
 //
@@ -88,6 +176,10 @@ iLogLevel (initLogLevel)
     
     // Clear the dataRefs arrays
     memset ( adrXP, 0, sizeof(adrXP));
+    
+    // X-Plane's COM radios are always there
+    for (int i = 1; i <= COM_CNT_XP; i++)
+        vCom.emplace_back(i);
 }
 
 // Find and register dataRefs
@@ -212,6 +304,24 @@ void DataRefs::Mute(bool bDoMute)
     COMChannel::MuteAll(bMute = bDoMute);
 }
 
+// Is the mix routed to this device additionally?
+bool DataRefs::IsAudioRoute (const std::string& devId) const
+{
+    return std::any_of(audioRoutes.begin(), audioRoutes.end(),
+                       [&devId](const AudioRouteTy& r){ return r.devId == devId; });
+}
+
+// Add or remove an additional audio output
+void DataRefs::ToggleAudioRoute (const std::string& devId)
+{
+    const auto iter = std::find_if(audioRoutes.begin(), audioRoutes.end(),
+                                   [&devId](const AudioRouteTy& r){ return r.devId == devId; });
+    if (iter != audioRoutes.end())
+        audioRoutes.erase(iter);
+    else
+        audioRoutes.push_back({devId, 100});
+}
+
 // Tell XP our ATIS preference
 void DataRefs::EnableXPsATIS (bool bEnable)
 {
@@ -250,6 +360,26 @@ positionTy DataRefs::GetUsersPlanePos() const
     return pos;
 }
 
+/// The radio horizon depends on the height of both antennas.
+/// The station's antenna is assumed `RADIO_ANT_STATION_M` above the
+/// airport's elevation, the plane's height is taken relative to the
+/// airport's elevation, too, so that terrain at both ends roughly cancels out.
+/// The configured maximum radio distance always caps the result.
+double DataRefs::GetRadioReach_nm (const positionTy& planePos,
+                                   const positionTy& stationPos) const
+{
+    const double maxDist_nm = GetMaxRadioDist();
+    if (!ShallUseRadioHorizon() || std::isnan(planePos.alt_m()))
+        return maxDist_nm;
+    
+    // height of plane's antenna above the station's elevation
+    const double stationElev_m = std::isnan(stationPos.alt_m()) ? 0.0 : stationPos.alt_m();
+    const double planeHeight_m = planePos.alt_m() - stationElev_m + RADIO_ANT_PLANE_M;
+    
+    const double horizon_nm = RadioHorizon_m(planeHeight_m, RADIO_ANT_STATION_M) / M_per_NM;
+    return std::min(horizon_nm, maxDist_nm);
+}
+
 //
 // MARK: Access to LiveTraffic
 //
@@ -280,6 +410,13 @@ int DataRefs::GetLTBufPeriod () const
 // MARK: Actual Current Observations
 //
 
+/// X-Plane's audio panel selects the mic by 6 = COM1 and 7 = COM2
+bool DataRefs::IsComTx(int idx) const
+{
+    return adrXP[DR_RADIO_COM_TX] && idx < COM_CNT_XP &&
+    XPLMGetDatai(adrXP[DR_RADIO_COM_TX]) == 6 + idx;
+}
+
 // should this COM channel be muted because not active?
 bool DataRefs::ShallMuteCom(int idx) const
 {
@@ -376,12 +513,26 @@ bool DataRefs::LoadConfigFile()
         
         // assign values appropriately
         
-        // toggle "act on COM#"
-        for (int i = 0; i < COM_CNT; i++) {
+        // toggle "act on COM#" and additional channel definitions
+        for (int i = 0; i < COM_CNT_MAX; i++) {
             char buf[50];
             snprintf(buf,sizeof(buf),CFG_MONITOR_COM,i+1);
             if (sCfgName == buf) {
-                bActOnCom[i] = bVal;
+                if (i >= GetComCnt())
+                    vCom.resize(i+1);
+                vCom[i].bActOn = bVal;
+                break;
+            }
+            snprintf(buf,sizeof(buf),CFG_CHANNEL,i+1);
+            if (i >= COM_CNT_XP && sCfgName == buf) {
+                if (i >= GetComCnt())
+                    vCom.resize(i+1);
+                const bool bActOn = vCom[i].bActOn;
+                if (!vCom[i].SetFromCfg(sRestOfLine)) {
+                    LOG_MSG(logWARN, ERR_CFG_CHANNEL, lnBuf.c_str());
+                    errCnt++;
+                }
+                vCom[i].bActOn = bActOn;
                 break;
             }
         }
@@ -389,6 +540,12 @@ bool DataRefs::LoadConfigFile()
         // other entries
              if (sCfgName == CFG_RESPECT_COM_SELECT)   bRespectAudioSelect = bVal;
         else if (sCfgName == CFG_AUDIO_DEVICE)      audioDev = sRestOfLine;
+        else if (sCfgName == CFG_AUDIO_ROUTE) {
+            // <gain> <device id>
+            const size_t pos = sRestOfLine.find(' ');
+            if (pos != std::string::npos && !IsAudioRoute(sRestOfLine.substr(pos+1)))
+                audioRoutes.push_back({sRestOfLine.substr(pos+1), std::clamp((int)lVal, 0, 100)});
+        }
         else if (sCfgName == CFG_VOLUME)            iVolume = (int)lVal;
         else if (sCfgName == CFG_LT_DESYNC_BUF)     bDesyncLiveTrafficDelay = bVal;
         else if (sCfgName == CFG_DESYNC_MANUAL_ADJ) desyncManual = (int)lVal;
@@ -396,6 +553,18 @@ bool DataRefs::LoadConfigFile()
         else if (sCfgName == CFG_PREBUFFER_STANDBY) bPreBufferStandbyFrequ = bVal;
         else if (sCfgName == CFG_ATIS_PREF_LIVEATC) bAtisPreferLiveATC = bVal;
         else if (sCfgName == CFG_MAX_RADIO_DIST)    maxRadioDist = (int)lVal;
+        else if (sCfgName == CFG_RADIO_HORIZON)     bRadioHorizon = bVal;
+        else if (sCfgName == CFG_TERRAIN_LOS)       bTerrainLOS = bVal;
+        else if (sCfgName == CFG_PREFETCH_FPLAN)    bPrefetchFPlan = bVal;
+        else if (sCfgName == CFG_WARM_POOL_SIZE)    SetWarmPoolSize((int)lVal);
+        else if (sCfgName == CFG_IDLE_RELEASE)      SetIdleReleaseS((int)lVal);
+        else if (sCfgName == CFG_AUDIO_MIXER)       bAudioMixer = bVal;
+        else if (sCfgName == CFG_AUDIO_BUF_MAX_KB)  SetAudioBufMaxKB((int)lVal);
+        else if (sCfgName == CFG_AUDIO_BUF_ULAW)    bAudioBufULaw = bVal;
+        else if (sCfgName == CFG_RADIO_FX)          bRadioFx = bVal;
+        else if (sCfgName == CFG_AUDIO_DUCK_PCT)    SetAudioDuckPct((int)lVal);
+        else if (sCfgName == CFG_REPLAY_MIN)        SetReplayMin((int)lVal);
+        else if (sCfgName == CFG_PREDICT_NEXT)      bPredictNext = bVal;
         else if (sCfgName == CFG_LOG_LEVEL)         iLogLevel = logLevelTy(lVal);
         else if (sCfgName == CFG_MSG_AREA_LEVEL)    iMsgAreaLevel = logLevelTy(lVal);
 #if !(IBM)
@@ -414,6 +583,10 @@ bool DataRefs::LoadConfigFile()
     
     // close file
     fIn.close();
+    
+    // drop trailing channels without definition
+    while (GetComCnt() > COM_CNT_XP && !vCom.back().IsDefined())
+        vCom.pop_back();
 
     // too many warnings?
     if (errCnt > ERR_CFG_FILE_MAXWARN) {
@@ -446,11 +619,15 @@ bool DataRefs::SaveConfigFile()
     
     // *** Config Entries ***
     
-    // toggle "act on COM#"
-    for (int i = 0; i < COM_CNT; i++) {
+    // toggle "act on COM#" and additional channel definitions
+    for (int i = 0; i < GetComCnt(); i++) {
         char buf[50];
+        if (i >= COM_CNT_XP) {
+            snprintf(buf,sizeof(buf),CFG_CHANNEL,i+1);
+            fOut << buf << ' ' << vCom[i].GetCfgString() << '\n';
+        }
         snprintf(buf,sizeof(buf),CFG_MONITOR_COM,i+1);
-        fOut << buf << ' ' << bActOnCom[i] << '\n';
+        fOut << buf << ' ' << vCom[i].bActOn << '\n';
     }
     
     // other entries
@@ -460,6 +637,8 @@ bool DataRefs::SaveConfigFile()
 #endif
     fOut << CFG_RESPECT_COM_SELECT  << ' ' << bRespectAudioSelect       << '\n';
     fOut << CFG_AUDIO_DEVICE        << ' ' << audioDev                  << '\n';
+    for (const AudioRouteTy& r: audioRoutes)
+        fOut << CFG_AUDIO_ROUTE     << ' ' << r.gain << ' ' << r.devId  << '\n';
     fOut << CFG_VOLUME              << ' ' << iVolume                   << '\n';
     fOut << CFG_LT_DESYNC_BUF       << ' ' << bDesyncLiveTrafficDelay   << '\n';
     fOut << CFG_DESYNC_MANUAL_ADJ   << ' ' << desyncManual              << '\n';
@@ -467,6 +646,18 @@ bool DataRefs::SaveConfigFile()
     fOut << CFG_PREBUFFER_STANDBY   << ' ' << bPreBufferStandbyFrequ    << '\n';
     fOut << CFG_ATIS_PREF_LIVEATC   << ' ' << bAtisPreferLiveATC        << '\n';
     fOut << CFG_MAX_RADIO_DIST      << ' ' << maxRadioDist              << '\n';
+    fOut << CFG_RADIO_HORIZON       << ' ' << bRadioHorizon             << '\n';
+    fOut << CFG_TERRAIN_LOS         << ' ' << bTerrainLOS               << '\n';
+    fOut << CFG_PREFETCH_FPLAN      << ' ' << bPrefetchFPlan            << '\n';
+    fOut << CFG_WARM_POOL_SIZE      << ' ' << warmPoolSize              << '\n';
+    fOut << CFG_IDLE_RELEASE        << ' ' << idleReleaseS              << '\n';
+    fOut << CFG_AUDIO_MIXER         << ' ' << bAudioMixer               << '\n';
+    fOut << CFG_AUDIO_BUF_MAX_KB    << ' ' << audioBufMaxKB             << '\n';
+    fOut << CFG_AUDIO_BUF_ULAW      << ' ' << bAudioBufULaw             << '\n';
+    fOut << CFG_RADIO_FX            << ' ' << bRadioFx                  << '\n';
+    fOut << CFG_AUDIO_DUCK_PCT      << ' ' << audioDuckPct              << '\n';
+    fOut << CFG_REPLAY_MIN          << ' ' << replayMin                 << '\n';
+    fOut << CFG_PREDICT_NEXT        << ' ' << bPredictNext              << '\n';
     fOut << CFG_LOG_LEVEL           << ' ' << iLogLevel                 << '\n';
     fOut << CFG_MSG_AREA_LEVEL      << ' ' << iMsgAreaLevel             << '\n';
     
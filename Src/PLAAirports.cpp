@@ -0,0 +1,243 @@
+//
+//  PLAAirports.cpp
+//  PlayLiveATC
+//
+// Compact in-memory table of all airports in X-Plane's nav database,
+// loaded once at startup in small per-frame time slices
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only airport table
+AirportTableTy gAirports;
+
+//
+// MARK: AirportTableTy
+//
+
+// Reads airports from the nav database till `budget` is used up
+bool AirportTableTy::DoWork (std::chrono::microseconds budget)
+{
+    using namespace std::chrono;
+    if (bLoaded)
+        return false;
+    
+    const steady_clock::time_point tStart = steady_clock::now();
+    
+    // answer lookups made before the table is loaded
+    FindPending();
+    
+    // start the walk
+    if (!bLoading) {
+        bLoading = true;
+        navNext = XPLMFindFirstNavAidOfType(xplm_Nav_Airport);
+    }
+    
+    // read airports till the budget is used up,
+    // checking the clock only every so many airports as it isn't for free
+    int n = 0;
+    while (navNext != XPLM_NAV_NOT_FOUND &&
+           ((++n % 32) || steady_clock::now() - tStart < budget))
+    {
+        XPLMNavType navType = xplm_Nav_Unknown;
+        float lat = NAN, lon = NAN, alt_m = NAN;
+        char szId[32] = "";
+        XPLMGetNavAidInfo(navNext, &navType, &lat, &lon, &alt_m, NULL, NULL, szId, NULL, NULL);
+        
+        // airports are stored consecutively, so the first non-airport ends the walk
+        if (navType != xplm_Nav_Airport) {
+            navNext = XPLM_NAV_NOT_FOUND;
+            break;
+        }
+        
+        const uint64_t key = PackIcao(szId);
+        if (key) {
+            vIcao.push_back(key);
+            vLat.push_back(lat);
+            vLon.push_back(lon);
+            vElev_m.push_back(alt_m);
+        }
+        navNext = XPLMGetNextNavAid(navNext);
+    }
+    
+    // walk finished? Then sort the table, which counts into this slice
+    const bool bDone = navNext == XPLM_NAV_NOT_FOUND;
+    if (bDone)
+        FinishLoading();
+    
+    // keep track of time spent
+    const microseconds tSlice = duration_cast<microseconds>(steady_clock::now() - tStart);
+    nFrames++;
+    tTotal += tSlice;
+    if (tSlice > tMaxSlice)
+        tMaxSlice = tSlice;
+    
+    if (bDone) {
+        // from now on lookups go to the table
+        bLoaded = true;
+        LOG_MSG(logMSG, MSG_AP_TABLE_LOADED, (unsigned long)vIcao.size(), nFrames,
+                (long long)tTotal.count(), (long long)tMaxSlice.count());
+    }
+    return !bDone;
+}
+
+/// XPLM functions must not be called from worker threads,
+/// so before the table is loaded the lookup is queued for FindPending().
+positionTy AirportTableTy::Find (const std::string& icao, bool* pbPending)
+{
+    if (pbPending)
+        *pbPending = false;
+    
+    // not yet loaded? Then use what X-Plane told us, or ask for it
+    if (!bLoaded) {
+        std::lock_guard<std::mutex> lock(mtxFallback);
+        const auto iter = mapFallback.find(icao);
+        if (iter != mapFallback.end())
+            return iter->second;
+        setPending.insert(icao);
+        if (pbPending)
+            *pbPending = true;
+        return positionTy();
+    }
+    
+    // binary search in the table
+    const uint64_t key = PackIcao(icao.c_str());
+    const auto iter = std::lower_bound(vIcao.cbegin(), vIcao.cend(), key);
+    if (!key || iter == vIcao.cend() || *iter != key)
+        return positionTy();
+    const size_t i = size_t(iter - vIcao.cbegin());
+    return positionTy(vLat[i], vLon[i], vElev_m[i]);
+}
+
+// Removes all entries, a new load is started with the next call to DoWork()
+void AirportTableTy::Clear ()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtxFallback);
+        setPending.clear();
+        mapFallback.clear();
+    }
+    bLoaded = false;
+    bLoading = false;
+    navNext = XPLM_NAV_NOT_FOUND;
+    nFrames = 0;
+    tTotal = tMaxSlice = std::chrono::microseconds(0);
+    vIcao.clear();      vIcao.shrink_to_fit();
+    vLat.clear();       vLat.shrink_to_fit();
+    vLon.clear();       vLon.shrink_to_fit();
+    vElev_m.clear();    vElev_m.shrink_to_fit();
+}
+
+// Packs up to 8 characters of an id into an integer, big endian, so it sorts like the id
+uint64_t AirportTableTy::PackIcao (const char* icao)
+{
+    if (!icao || !*icao)
+        return 0;
+    uint64_t key = 0;
+    int i = 0;
+    for (; i < 8 && icao[i]; i++)
+        key = (key << 8) | uint8_t(icao[i]);
+    if (icao[i])                        // longer than 8 chars: can't pack
+        return 0;
+    return key << (8 * (8-i));          // left-align to keep lexical order
+}
+
+// Look up queued ids with `XPLMFindNavAid`, main thread only
+void AirportTableTy::FindPending ()
+{
+    std::set<std::string> setIds;
+    {
+        std::lock_guard<std::mutex> lock(mtxFallback);
+        if (setPending.empty())
+            return;
+        setIds.swap(setPending);
+    }
+    
+    for (const std::string& icao: setIds) {
+        float lat = NAN, lon = NAN, alt_m = NAN;
+        XPLMNavRef apRef = XPLMFindNavAid(NULL, icao.c_str(), NULL, NULL, NULL, xplm_Nav_Airport);
+        if (apRef != XPLM_NAV_NOT_FOUND)
+            XPLMGetNavAidInfo(apRef, NULL, &lat, &lon, &alt_m, NULL, NULL, NULL, NULL, NULL);
+        std::lock_guard<std::mutex> lock(mtxFallback);
+        mapFallback.emplace(icao, positionTy(lat, lon, alt_m));
+    }
+}
+
+/// Sorts all four vectors by packed id via an index permutation.
+/// Duplicate ids (same airport in several scenery packs) keep the first entry.
+void AirportTableTy::FinishLoading ()
+{
+    std::vector<uint32_t> idx(vIcao.size());
+    for (uint32_t i = 0; i < idx.size(); i++)
+        idx[i] = i;
+    std::stable_sort(idx.begin(), idx.end(),
+                     [this](uint32_t a, uint32_t b){ return vIcao[a] < vIcao[b]; });
+    
+    std::vector<uint64_t> sIcao;
+    std::vector<float> sLat, sLon, sElev;
+    sIcao.reserve(idx.size());
+    sLat.reserve(idx.size());
+    sLon.reserve(idx.size());
+    sElev.reserve(idx.size());
+    for (uint32_t i: idx) {
+        if (!sIcao.empty() && sIcao.back() == vIcao[i])
+            continue;
+        sIcao.push_back(vIcao[i]);
+        sLat.push_back(vLat[i]);
+        sLon.push_back(vLon[i]);
+        sElev.push_back(vElev_m[i]);
+    }
+    vIcao.swap(sIcao);
+    vLat.swap(sLat);
+    vLon.swap(sLon);
+    vElev_m.swap(sElev);
+}
+
+//
+// MARK: Flight loop callback
+//
+
+/// Called every frame till the table is loaded, then deactivates itself
+float AirportsFlightLoopCB (float, float, int, void*)
+{
+    return gAirports.DoWork(AP_TABLE_FRAME_BUDGET) ? -1.0f : 0.0f;
+}
+
+// Start loading the airport table from a flight loop callback
+void AirportsStart ()
+{
+    XPLMRegisterFlightLoopCallback(AirportsFlightLoopCB, -1.0f, NULL);
+}
+
+// Stop loading and clear the airport table
+void AirportsStop ()
+{
+    XPLMUnregisterFlightLoopCallback(AirportsFlightLoopCB, NULL);
+    gAirports.Clear();
+}
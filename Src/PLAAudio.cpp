@@ -0,0 +1,862 @@
+//
+//  PLAAudio.cpp
+//  PlayLiveATC
+//
+// In-process audio mixer: VLC delivers decoded audio via callbacks
+// into feeds, which voices read from and which are mixed into one OpenAL source
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only audio mixer
+AudioMixerTy gMixer;
+
+//
+// MARK: Sample encoding
+//
+
+// G.711 mu-law encoding of a 16 bit sample
+uint8_t ULawEncode (int16_t pcm)
+{
+    constexpr int BIAS = 0x84, CLIP = 32635;
+    const int sign = pcm < 0 ? 0x80 : 0;
+    int s = sign ? -int(pcm) : int(pcm);
+    if (s > CLIP) s = CLIP;
+    s += BIAS;
+    int exp = 7;
+    for (int mask = 0x4000; !(s & mask) && exp > 0; mask >>= 1)
+        exp--;
+    const int mant = (s >> (exp + 3)) & 0x0F;
+    return uint8_t(~(sign | (exp << 4) | mant));
+}
+
+// Decoding table for mu-law, straight to float
+const std::array<float,256>& ULawTable ()
+{
+    static const std::array<float,256> tbl = []{
+        std::array<float,256> t;
+        for (int i = 0; i < 256; i++) {
+            const int u = ~i & 0xFF;
+            const int exp = (u >> 4) & 0x07;
+            const int s = (((u & 0x0F) << 3) + 0x84) << exp;
+            t[size_t(i)] = float((u & 0x80) ? 0x84 - s : s - 0x84) / 32768.0f;
+        }
+        return t;
+    }();
+    return tbl;
+}
+
+//
+// MARK: Radio effect
+//
+
+/// Smoothing factor per block for a time constant of `ms`
+static float FxBlockCoeff (float ms)
+{
+    return 1.0f - std::exp(-float(AUDIO_FX_BLOCK) * 1000.0f / (float(AUDIO_RATE) * ms));
+}
+
+/// RBJ cookbook lowpass with Q = 1/sqrt(2)
+void AudioBiquadTy::SetLowpass (float hz)
+{
+    const float w0 = 2.0f * float(M_PI) * hz / float(AUDIO_RATE);
+    const float c = std::cos(w0), alpha = std::sin(w0) / std::sqrt(2.0f);
+    const float a0 = 1.0f + alpha;
+    b0 = (1.0f - c) / 2.0f / a0;
+    b1 = (1.0f - c) / a0;
+    b2 = b0;
+    a1 = -2.0f * c / a0;
+    a2 = (1.0f - alpha) / a0;
+}
+
+/// RBJ cookbook highpass with Q = 1/sqrt(2)
+void AudioBiquadTy::SetHighpass (float hz)
+{
+    const float w0 = 2.0f * float(M_PI) * hz / float(AUDIO_RATE);
+    const float c = std::cos(w0), alpha = std::sin(w0) / std::sqrt(2.0f);
+    const float a0 = 1.0f + alpha;
+    b0 = (1.0f + c) / 2.0f / a0;
+    b1 = -(1.0f + c) / a0;
+    b2 = b0;
+    a1 = -2.0f * c / a0;
+    a2 = (1.0f - alpha) / a0;
+}
+
+// Filter samples in place
+void AudioBiquadTy::Process (float* buf, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        const float x = buf[i];
+        const float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        buf[i] = y;
+    }
+}
+
+// Sets up the voice band filters
+AudioRadioFxTy::AudioRadioFxTy ()
+{
+    hp.SetHighpass(AUDIO_FX_LOW_HZ);
+    lp.SetLowpass(AUDIO_FX_HIGH_HZ);
+    noise.fill(0.0f);
+    // different non-zero seeds for the noise generators
+    for (unsigned i = 0; i < AUDIO_FX_BLOCK; i++)
+        rnd[i] = 0x9E3779B9u * (i + 1);
+}
+
+// Process samples in place, block by block
+void AudioRadioFxTy::Process (float* buf, unsigned n)
+{
+    for (unsigned i = 0; i < n; i += AUDIO_FX_BLOCK)
+        ProcessBlock(buf + i, std::min(AUDIO_FX_BLOCK, n - i));
+}
+
+/// Gains are determined once per block and ramped linearly across it,
+/// which avoids zipper noise and keeps the per-sample work to
+/// multiply-adds over arrays.
+void AudioRadioFxTy::ProcessBlock (float* buf, unsigned n)
+{
+    static const float aAttack = FxBlockCoeff(AUDIO_FX_ATTACK_MS);
+    static const float aRelease = FxBlockCoeff(AUDIO_FX_RELEASE_MS);
+    
+    // *** Squelch: static only while there is a signal ***
+    float peak = Peak(buf, n);
+    sqlLevel += (peak > sqlLevel ? aAttack : aRelease) * (peak - sqlLevel);
+    const float sqlTarget = sqlLevel > AUDIO_FX_SQUELCH ? float(staticLvl) : 0.0f;
+    
+    // white noise (xorshift32, one generator per sample), then mixed in with a ramped gain
+    if (sqlTarget > 0.0f || sqlGain > 0.0f) {
+        for (unsigned i = 0; i < n; i++) {
+            uint32_t r = rnd[i];
+            r ^= r << 13;
+            r ^= r >> 17;
+            r ^= r << 5;
+            rnd[i] = r;
+            noise[i] = float(int32_t(r)) * (1.0f / 2147483648.0f);
+        }
+        const float dS = (sqlTarget - sqlGain) / float(n);
+        for (unsigned i = 0; i < n; i++)
+            buf[i] += (sqlGain + dS * float(i + 1)) * noise[i];
+    }
+    sqlGain = sqlTarget;
+    
+    // *** Voice band ***
+    hp.Process(buf, n);
+    lp.Process(buf, n);
+    
+    // *** Compression ***
+    peak = Peak(buf, n);
+    env += (peak > env ? aAttack : aRelease) * (peak - env);
+    const float compTarget = AUDIO_FX_COMP_MAKEUP *
+    (env > AUDIO_FX_COMP_THR ? std::pow(AUDIO_FX_COMP_THR / env, 1.0f - 1.0f / AUDIO_FX_COMP_RATIO) : 1.0f);
+    const float dC = (compTarget - compGain) / float(n);
+    for (unsigned i = 0; i < n; i++)
+        buf[i] *= compGain + dC * float(i + 1);
+    compGain = compTarget;
+}
+
+/// Halves the block again and again, each time taking the element-wise
+/// maximum of both halves, which the compiler vectorizes.
+/// A short block is padded with zeros.
+float AudioRadioFxTy::Peak (const float* buf, unsigned n)
+{
+    std::array<float,AUDIO_FX_BLOCK> a;
+    for (unsigned i = 0; i < n; i++)
+        a[i] = std::abs(buf[i]);
+    for (unsigned i = n; i < AUDIO_FX_BLOCK; i++)
+        a[i] = 0.0f;
+    for (unsigned s = AUDIO_FX_BLOCK / 2; s > 0; s /= 2)
+        for (unsigned i = 0; i < s; i++)
+            a[i] = a[i+s] > a[i] ? a[i+s] : a[i];
+    return a[0];
+}
+
+//
+// MARK: AudioFeedTy
+//
+
+/// The ring holds `AUDIO_RING_S` plus the desync period,
+/// but not more than `maxBytes` and not less than `AUDIO_RING_S`.
+AudioFeedTy::AudioFeedTy (long desyncSecs, AudioEncTy e, size_t maxBytes) :
+enc(e)
+{
+    const size_t sz = enc == AUDIO_ENC_ULAW ? 1 : 2;
+    const size_t capMax = maxBytes / sz;
+    cap = size_t(AUDIO_RING_S + std::clamp(desyncSecs, 0L, long(capMax / AUDIO_RATE))) * AUDIO_RATE;
+    cap = std::max(std::min(cap, capMax), size_t(AUDIO_RING_S) * AUDIO_RATE);
+    ring.assign(cap * sz, enc == AUDIO_ENC_ULAW ? ULawEncode(0) : 0);
+}
+
+// Destructor logs dropped samples
+AudioFeedTy::~AudioFeedTy ()
+{
+    if (cntDropped)
+        LOG_MSG(logDEBUG, DBG_AUDIO_FEED_DROP, cntDropped);
+}
+
+/// The ring must keep `AUDIO_RING_S` of room for VLC's delivery ahead of time
+int64_t AudioFeedTy::GetMaxDelayUs () const
+{
+    return int64_t(cap / AUDIO_RATE - AUDIO_RING_S) * 1000000;
+}
+
+// Have VLC deliver the player's audio to this feed
+void AudioFeedTy::Attach (VLC::MediaPlayer& mp)
+{
+    libvlc_audio_set_callbacks(mp.get(), cbPlay, nullptr, nullptr, cbFlush, nullptr, this);
+    libvlc_audio_set_format(mp.get(), AUDIO_FORMAT, AUDIO_RATE, 1);
+}
+
+/// Samples are only published once the chunk fits completely into the
+/// ring without overwriting what the slowest voice still has to play,
+/// otherwise it is dropped. Contiguous audio extends the last chunk.
+void AudioFeedTy::Write (const float* samples, unsigned count, int64_t pts)
+{
+    if (!count)
+        return;
+    const size_t t = tail.load(std::memory_order_relaxed);
+    const size_t nc = nChunks.load(std::memory_order_relaxed);
+    
+    // how far has the slowest voice come?
+    size_t minHead = t;
+    size_t minChunk = nc ? nc - 1 : 0;
+    {
+        std::lock_guard<std::mutex> lock(mtxReaders);
+        for (const AudioVoiceTy* v: readers) {
+            minHead = std::min(minHead, v->head.load(std::memory_order_acquire));
+            minChunk = std::min(minChunk, v->chunk.load(std::memory_order_acquire));
+        }
+    }
+    
+    // contiguous to the last chunk? Then that chunk just grows
+    AudioChunkTy& last = chunks[(nc ? nc - 1 : 0) % AUDIO_CHUNKS];
+    bool bMerge = false;
+    if (nc) {
+        const size_t lc = last.count.load(std::memory_order_relaxed);
+        bMerge = last.start.load(std::memory_order_relaxed) + lc == t &&
+        std::abs(last.pts.load(std::memory_order_relaxed) + int64_t(lc) * 1000000 / AUDIO_RATE - pts) <= AUDIO_PTS_TOL_US;
+    }
+    
+    // room?
+    if (count > cap - (t - minHead) || (!bMerge && nc - minChunk >= AUDIO_CHUNKS)) {
+        cntDropped += count;
+        return;
+    }
+    
+    for (unsigned i = 0; i < count; i++)
+        Encode((t + i) % cap, samples[i]);
+    tail.store(t + count, std::memory_order_release);
+    if (bMerge)
+        last.count.fetch_add(count, std::memory_order_release);
+    else {
+        AudioChunkTy& c = chunks[nc % AUDIO_CHUNKS];
+        c.pts.store(pts, std::memory_order_relaxed);
+        c.start.store(t, std::memory_order_relaxed);
+        c.count.store(count, std::memory_order_relaxed);
+        nChunks.store(nc + 1, std::memory_order_release);
+    }
+}
+
+// Voice starts reading at the current end of the feed
+void AudioFeedTy::AddReader (AudioVoiceTy* v)
+{
+    std::lock_guard<std::mutex> lock(mtxReaders);
+    const size_t nc = nChunks.load(std::memory_order_acquire);
+    v->chunk.store(nc ? nc - 1 : 0, std::memory_order_relaxed);
+    v->head.store(tail.load(std::memory_order_acquire), std::memory_order_relaxed);
+    v->flushGen = flushGen;
+    readers.push_back(v);
+}
+
+// Voice stops reading
+void AudioFeedTy::RemoveReader (AudioVoiceTy* v)
+{
+    std::lock_guard<std::mutex> lock(mtxReaders);
+    readers.erase(std::remove(readers.begin(), readers.end(), v), readers.end());
+}
+
+// Store one sample encoded
+void AudioFeedTy::Encode (size_t i, float f)
+{
+    const int16_t pcm = int16_t(std::clamp(f, -1.0f, 1.0f) * 32767.0f);
+    if (enc == AUDIO_ENC_ULAW)
+        ring[i] = ULawEncode(pcm);
+    else
+        std::memcpy(&ring[2*i], &pcm, sizeof(pcm));
+}
+
+// Decode one sample
+float AudioFeedTy::Decode (size_t i) const
+{
+    if (enc == AUDIO_ENC_ULAW)
+        return ULawTable()[ring[i]];
+    int16_t pcm;
+    std::memcpy(&pcm, &ring[2*i], sizeof(pcm));
+    return float(pcm) / 32768.0f;
+}
+
+// VLC callback: play samples
+void AudioFeedTy::cbPlay (void* data, const void* samples, unsigned count, int64_t pts)
+{
+    static_cast<AudioFeedTy*>(data)->Write(static_cast<const float*>(samples), count, pts);
+}
+
+// VLC callback: discard pending samples
+void AudioFeedTy::cbFlush (void* data, int64_t)
+{
+    static_cast<AudioFeedTy*>(data)->flushGen++;
+}
+
+//
+// MARK: AudioVoiceTy
+//
+
+// Constructor starts reading at the feed's current end
+AudioVoiceTy::AudioVoiceTy (const AudioFeedPtrTy& feed) :
+pFeed(feed)
+{
+    pFeed->AddReader(this);
+}
+
+// Destructor stops reading
+AudioVoiceTy::~AudioVoiceTy ()
+{
+    pFeed->RemoveReader(this);
+}
+
+// Switch the radio effect on or off
+void AudioVoiceTy::SetRadioFx (bool bOn, float staticLvl)
+{
+    fx.SetStatic(std::clamp(staticLvl, 0.0f, AUDIO_FX_STATIC_MAX));
+    bFx = bOn;
+}
+
+// Set the audio desync period, limited by the feed's size
+int64_t AudioVoiceTy::SetDelay (int64_t us)
+{
+    delayUs = std::clamp(us, int64_t(0), pFeed->GetMaxDelayUs());
+    return delayUs;
+}
+
+// Audio buffered for this voice
+int64_t AudioVoiceTy::GetBufferedUs () const
+{
+    const size_t n = pFeed->tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    return int64_t(n) * 1000000 / AUDIO_RATE;
+}
+
+/// Before anything was played, that's the desync period
+/// minus what is already buffered: The countdown only
+/// proceeds while audio actually arrives.
+int64_t AudioVoiceTy::GetDesyncRemainUs () const
+{
+    if (bAudible)
+        return 0;
+    return std::max(delayUs - GetBufferedUs(), int64_t(0));
+}
+
+/// Mixes as long as samples are due, which is VLC's pts plus the desync
+/// period. Samples due within the buffer start at their exact position.
+/// Samples a bit late are skipped where quiet, samples way too late
+/// (only after an underrun, retargeting never gets that late) are skipped
+/// so that we catch up.
+/// The voice is first collected in `buf`, the radio effect processes the
+/// whole buffer, and then it is added to `acc` with the gain ramping
+/// sample by sample from where it was toward the target.
+unsigned AudioVoiceTy::Mix (float* acc, unsigned n, int64_t playTime, float duck)
+{
+    const AudioFeedTy& f = *pFeed;
+    size_t pos = head.load(std::memory_order_relaxed);
+    size_t ci = chunk.load(std::memory_order_relaxed);
+    
+    // VLC asked to discard everything pending?
+    const unsigned fg = f.flushGen;
+    if (fg != flushGen) {
+        flushGen = fg;
+        const size_t nc = f.nChunks.load(std::memory_order_acquire);
+        chunk.store(nc ? nc - 1 : 0, std::memory_order_release);
+        head.store(f.tail.load(std::memory_order_acquire), std::memory_order_release);
+        bAudible = false;
+        lateUs = -1;
+        return 0;
+    }
+    
+    buf.assign(n, 0.0f);
+    
+    // follow a changed desync period: at once before anything was played,
+    // otherwise only in pauses and step by step, so that no word is cut.
+    // Shorter: the next step only once the previous one was caught up with.
+    const int64_t delayTarget = delayUs;
+    if (!bAudible)
+        playDelayUs = delayTarget;
+    else if (level <= AUDIO_DUCK_THR) {
+        if (delayTarget > playDelayUs)
+            playDelayUs = std::min(delayTarget, playDelayUs + AUDIO_RETARGET_STEP_US);
+        else if (delayTarget < playDelayUs && 0 <= lateUs && lateUs <= AUDIO_RETARGET_TOL_US)
+            playDelayUs = std::max(delayTarget, playDelayUs - AUDIO_RETARGET_STEP_US);
+    }
+    const int64_t delay = playDelayUs;
+    lateUs = -1;
+    unsigned done = 0;
+    bool bMixed = false;
+    while (done < n) {
+        // the chunk we are in
+        if (ci >= f.nChunks.load(std::memory_order_acquire))
+            break;                          // nothing available at all
+        const AudioChunkTy& c = f.chunks[ci % AUDIO_CHUNKS];
+        const size_t cStart = c.start.load(std::memory_order_relaxed);
+        const size_t cEnd = cStart + c.count.load(std::memory_order_acquire);
+        if (pos < cStart)
+            pos = cStart;
+        if (pos >= cEnd) {
+            if (ci + 1 >= f.nChunks.load(std::memory_order_acquire))
+                break;                      // nothing more available
+            ci++;
+            continue;
+        }
+        
+        // when is the sample we are at due, and when would it be played?
+        const int64_t tDue = c.pts.load(std::memory_order_relaxed) +
+        int64_t(pos - cStart) * 1000000 / AUDIO_RATE + delay;
+        const int64_t tPlay = playTime + int64_t(done) * 1000000 / AUDIO_RATE;
+        
+        // too late? Then skip what's late
+        if (tPlay - tDue > AUDIO_MAX_LATE_US) {
+            const size_t skip = std::min(size_t((tPlay - tDue) * AUDIO_RATE / 1000000), cEnd - pos);
+            pos += skip;
+            cntDropped += (unsigned long)skip;
+            continue;
+        }
+        
+        // a bit late? Then catch up by skipping what's quiet
+        if (tPlay - tDue > AUDIO_RETARGET_TOL_US) {
+            const size_t skip = std::min({size_t((tPlay - tDue) * AUDIO_RATE / 1000000),
+                                          cEnd - pos, size_t(AUDIO_BUF_FRAMES)});
+            size_t i = 0;
+            while (i < skip && std::abs(f.Decode((pos + i) % f.cap)) <= AUDIO_DUCK_THR)
+                i++;
+            if (i == skip) {
+                pos += skip;
+                continue;
+            }
+        }
+        
+        // not yet due? Then it starts later in this buffer, if at all
+        if (tDue > tPlay) {
+            const int64_t at = (tDue - playTime) * AUDIO_RATE / 1000000;
+            if (at >= int64_t(n))
+                break;
+            done = std::max(done, unsigned(at));
+        }
+        
+        // mix as much of the chunk as fits
+        if (lateUs < 0)
+            lateUs = std::max(tPlay - tDue, int64_t(0));
+        const unsigned k = unsigned(std::min(cEnd - pos, size_t(n - done)));
+        for (unsigned i = 0; i < k; i++)
+            buf[done + i] = f.Decode((pos + i) % f.cap);
+        pos += k;
+        done += k;
+        bMixed = true;
+    }
+    head.store(pos, std::memory_order_release);
+    chunk.store(ci, std::memory_order_release);
+    if (bMixed)
+        bAudible = true;
+    
+    // radio effect runs over the entire buffer, so that filters ring out
+    if (bFx) {
+        const auto tStart = std::chrono::steady_clock::now();
+        fx.Process(buf.data(), n);
+        fxNs += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>
+                         (std::chrono::steady_clock::now() - tStart).count());
+        cntFxSamples += n;
+    }
+    
+    // signal level, decides about ducking others
+    static const float levelRelease = std::exp(-float(AUDIO_BUF_MS) / AUDIO_DUCK_RELEASE_MS);
+    float peak = 0.0f;
+    for (unsigned i = 0; i < n; i++)
+        peak = std::max(peak, std::abs(buf[i]));
+    level = std::max(peak, level * levelRelease);
+    
+    // keep what is received for a "say again"
+    ReplayRingTy* const rec = pRec;
+    if (rec && n == REPLAY_FRAME_SAMPLES)
+        rec->Record(buf.data(), HasSignal());
+    
+    // gain ramps at a fixed slope, so a full change takes `AUDIO_RAMP_MS`
+    const float target = gain * duck;
+    const float step = 1000.0f / float(AUDIO_RATE * AUDIO_RAMP_MS);
+    const unsigned kRamp = unsigned(std::ceil(std::abs(target - curGain) / step));
+    const float d = kRamp ? (target - curGain) / float(kRamp) : 0.0f;
+    const unsigned k = std::min(n, kRamp);
+    for (unsigned i = 0; i < k; i++)
+        acc[i] += (curGain + d * float(i + 1)) * buf[i];
+    curGain = k == kRamp ? target : curGain + d * float(k);
+    for (unsigned i = k; i < n; i++)
+        acc[i] += curGain * buf[i];
+    return done;
+}
+
+//
+// MARK: AudioOutputTy
+//
+
+/// Creates our own context and the source, queues silence,
+/// and starts playing. X-Plane's context is restored afterwards.
+bool AudioOutputTy::Open (const std::string& dev)
+{
+    // open the device and create our context
+    pDev = alcOpenDevice(dev.empty() ? nullptr : dev.c_str());
+    if (pDev)
+        pCtx = alcCreateContext(pDev, nullptr);
+    if (!pCtx) {
+        LOG_MSG(logERR, ERR_AUDIO_OPEN, dev.c_str());
+        if (pDev)
+            alcCloseDevice(pDev);
+        pDev = nullptr;
+        return false;
+    }
+    alDevName = dev;
+    
+    ALCcontext* prevCtx = alcGetCurrentContext();
+    alcMakeContextCurrent(pCtx);
+    
+    // one source, not positioned, playing the mix
+    alGenSources(1, &src);
+    alSourcei(src, AL_SOURCE_RELATIVE, 1);
+    alSource3f(src, AL_POSITION, 0.0f, 0.0f, 0.0f);
+    alSourcef(src, AL_ROLLOFF_FACTOR, 0.0f);
+    
+    // start with silence
+    alGenBuffers(AUDIO_AL_BUFFERS, bufs);
+    pcm.assign(AUDIO_BUF_FRAMES, 0);
+    for (ALuint b: bufs)
+        alBufferData(b, AL_FORMAT_MONO16, pcm.data(), ALsizei(pcm.size() * sizeof(int16_t)), AUDIO_RATE);
+    alSourceQueueBuffers(src, AUDIO_AL_BUFFERS, bufs);
+    alSourcePlay(src);
+    
+    alcMakeContextCurrent(prevCtx);
+    LOG_MSG(logDEBUG, DBG_AUDIO_OPEN, dev.empty() ? "(default)" : dev.c_str());
+    return true;
+}
+
+// Close the device
+void AudioOutputTy::Close ()
+{
+    if (!pCtx)
+        return;
+    ALCcontext* prevCtx = alcGetCurrentContext();
+    alcMakeContextCurrent(pCtx);
+    alSourceStop(src);
+    alSourcei(src, AL_BUFFER, 0);
+    alDeleteSources(1, &src);
+    alDeleteBuffers(AUDIO_AL_BUFFERS, bufs);
+    alcMakeContextCurrent(prevCtx == pCtx ? nullptr : prevCtx);
+    alcDestroyContext(pCtx);
+    alcCloseDevice(pDev);
+    pCtx = nullptr;
+    pDev = nullptr;
+    src = 0;
+    pendHead = pendCnt = 0;
+}
+
+// Number of buffers played and waiting to be refilled
+int AudioOutputTy::GetProcessed () const
+{
+    ALint processed = 0;
+    alGetSourcei(src, AL_BUFFERS_PROCESSED, &processed);
+    return processed;
+}
+
+// Refill one processed buffer with the mix, applying our gain
+void AudioOutputTy::Refill (const float* mix)
+{
+    ALuint b = 0;
+    alSourceUnqueueBuffers(src, 1, &b);
+    if (mix)
+        for (size_t i = 0; i < pcm.size(); i++)
+            pcm[i] = int16_t(std::clamp(gain * mix[i], -1.0f, 1.0f) * 32767.0f);
+    else
+        std::fill(pcm.begin(), pcm.end(), int16_t(0));
+    alBufferData(b, AL_FORMAT_MONO16, pcm.data(), ALsizei(pcm.size() * sizeof(int16_t)), AUDIO_RATE);
+    alSourceQueueBuffers(src, 1, &b);
+}
+
+// Restart the source if it ran dry
+void AudioOutputTy::KeepPlaying ()
+{
+    ALint state = 0;
+    alGetSourcei(src, AL_SOURCE_STATE, &state);
+    if (state != AL_PLAYING) {
+        cntUnderrun++;
+        alSourcePlay(src);
+    }
+}
+
+/// Devices' clocks differ slightly. If this device plays slower
+/// than the primary one, the oldest pending buffer is skipped.
+void AudioOutputTy::PushPending (const float* mix)
+{
+    if (pend.empty())
+        pend.resize(size_t(AUDIO_AL_BUFFERS) * AUDIO_BUF_FRAMES);
+    if (pendCnt >= AUDIO_AL_BUFFERS) {
+        pendHead = (pendHead + 1) % AUDIO_AL_BUFFERS;
+        pendCnt--;
+        cntSkipped++;
+    }
+    const unsigned slot = (pendHead + pendCnt) % AUDIO_AL_BUFFERS;
+    std::copy(mix, mix + AUDIO_BUF_FRAMES, pend.begin() + long(slot) * AUDIO_BUF_FRAMES);
+    pendCnt++;
+}
+
+// Oldest pending buffer
+const float* AudioOutputTy::PopPending ()
+{
+    if (!pendCnt)
+        return nullptr;
+    const float* p = pend.data() + size_t(pendHead) * AUDIO_BUF_FRAMES;
+    pendHead = (pendHead + 1) % AUDIO_AL_BUFFERS;
+    pendCnt--;
+    return p;
+}
+
+//
+// MARK: AudioMixerTy
+//
+
+// Open the primary OpenAL device and start playing
+bool AudioMixerTy::Start (const std::string& dev)
+{
+    if (bActive)
+        Stop();
+    acc.assign(AUDIO_BUF_FRAMES, 0.0f);
+    bActive = out.Open(dev) || (!dev.empty() && out.Open(std::string()));
+    if (bActive)
+        ApplyRoutes();
+    return bActive;
+}
+
+// Stop playing, close all devices
+void AudioMixerTy::Stop ()
+{
+    if (!bActive)
+        return;
+    bActive = false;
+    unsigned long cntUnderrun = out.cntUnderrun, cntSkipped = 0;
+    for (const AudioOutputTy& r: routes) {
+        cntUnderrun += r.cntUnderrun;
+        cntSkipped += r.cntSkipped;
+    }
+    routes.clear();
+    out.Close();
+    out.cntUnderrun = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const AudioVoicePtrTy& v: voices) {
+            cntDropped += v->GetDropped();
+            cntFxSamples += v->GetFxSamples();
+            fxNs += v->GetFxNs();
+        }
+        voices.clear();
+    }
+    LOG_MSG(logINFO, MSG_AUDIO_STATS, cntMixed, cntUnderrun, cntDropped, cntSkipped);
+    if (cntFxSamples) {
+        const double secs = double(cntFxSamples) / AUDIO_RATE;
+        LOG_MSG(logINFO, MSG_AUDIO_FX_STATS, secs, double(fxNs) / 1000000.0,
+                double(fxNs) / 1e9 / secs * 100.0);
+    }
+    cntMixed = cntDropped = cntFxSamples = 0;
+    fxNs = 0;
+}
+
+/// VLC and OpenAL name devices differently. The VLC device's description
+/// is matched against OpenAL's device names.
+std::string AudioMixerTy::MapDevice (const std::string& vlcDevId)
+{
+    // find the VLC device's description
+    std::string desc;
+    for (const VLC::AudioOutputDeviceDescription& d: gVLCOutputDevs)
+        if (d.device() == vlcDevId)
+            desc = d.description();
+    
+    // find a matching OpenAL device
+    if (!desc.empty())
+        for (const std::string& n: EnumDevices())
+            if (n.find(desc) != std::string::npos || desc.find(n) != std::string::npos)
+                return n;
+    return std::string();
+}
+
+/// Falls back to the default device if there is no matching OpenAL device.
+/// Additional outputs are re-evaluated as one of them might be the new primary device.
+void AudioMixerTy::SetDevice (const std::string& vlcDevId)
+{
+    const std::string alDev = MapDevice(vlcDevId);
+    
+    // reopen if it's a different device, the voices just continue
+    if (!bActive || alDev == out.alDevName)
+        return;
+    out.Close();
+    if (!out.Open(alDev) && !alDev.empty())
+        out.Open(std::string());
+    out.vlcDevId = vlcDevId;
+    ApplyRoutes();
+}
+
+// Set the additional outputs
+void AudioMixerTy::SetRoutes (const std::vector<AudioRouteTy>& r)
+{
+    cfgRoutes = r;
+    if (bActive)
+        ApplyRoutes();
+}
+
+/// Additional outputs need an identifiable OpenAL device,
+/// which is not the primary one or used by another route already.
+void AudioMixerTy::ApplyRoutes ()
+{
+    std::list<AudioOutputTy> keep;
+    for (const AudioRouteTy& cfg: cfgRoutes) {
+        const std::string alDev = MapDevice(cfg.devId);
+        if (alDev.empty() || alDev == out.alDevName ||
+            std::any_of(keep.begin(), keep.end(),
+                        [&alDev](const AudioOutputTy& o){ return o.alDevName == alDev; }))
+        {
+            LOG_MSG(logWARN, WARN_AUDIO_ROUTE, cfg.devId.c_str());
+            continue;
+        }
+        
+        // already open? Then keep it, otherwise open it
+        auto iter = std::find_if(routes.begin(), routes.end(),
+                                 [&alDev](const AudioOutputTy& o){ return o.alDevName == alDev; });
+        if (iter != routes.end())
+            keep.splice(keep.end(), routes, iter);
+        else {
+            keep.emplace_back();
+            if (!keep.back().Open(alDev)) {
+                keep.pop_back();
+                continue;
+            }
+            LOG_MSG(logDEBUG, DBG_AUDIO_ROUTE, alDev.c_str(), cfg.gain);
+        }
+        keep.back().vlcDevId = cfg.devId;
+        keep.back().gain = float(cfg.gain) / 100.0f;
+    }
+    routes.swap(keep);                  // closes those no longer configured
+}
+
+// Add a voice to the mix
+void AudioMixerTy::Add (const AudioVoicePtrTy& v)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    voices.push_back(v);
+}
+
+// Remove a voice from the mix
+void AudioMixerTy::Remove (const AudioVoicePtrTy& v)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    const auto iter = std::find(voices.begin(), voices.end(), v);
+    if (iter != voices.end()) {
+        cntDropped += v->GetDropped();
+        cntFxSamples += v->GetFxSamples();
+        fxNs += v->GetFxNs();
+        voices.erase(iter);
+    }
+}
+
+/// The primary output drives mixing: Each of its processed buffers is refilled
+/// with the mix of what will be due when that buffer is played, i.e. after
+/// all buffers still queued. Additional outputs receive the same mix and
+/// queue it as they have room.
+void AudioMixerTy::Pump ()
+{
+    if (!bActive)
+        return;
+    ALCcontext* prevCtx = alcGetCurrentContext();
+    
+    // primary output
+    out.MakeCurrent();
+    const int processed = out.GetProcessed();
+    const int64_t now = libvlc_clock();
+    for (int i = 0; i < processed; i++) {
+        MixBuffer(now + int64_t(AUDIO_AL_BUFFERS - processed + i) * AUDIO_BUF_MS * 1000);
+        out.Refill(acc.data());
+        for (AudioOutputTy& r: routes)
+            r.PushPending(acc.data());
+    }
+    out.KeepPlaying();
+    
+    // additional outputs, each at its own pace
+    for (AudioOutputTy& r: routes) {
+        r.MakeCurrent();
+        for (int n = r.GetProcessed(); n > 0; n--)
+            r.Refill(r.PopPending());
+        r.KeepPlaying();
+    }
+    
+    alcMakeContextCurrent(prevCtx);
+}
+
+/// Voices ducking others are mixed first, so that their signal
+/// ducks the others within the very same buffer.
+void AudioMixerTy::MixBuffer (int64_t playTime)
+{
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bool bDuck = false;
+        for (const AudioVoicePtrTy& v: voices)
+            if (v->LatchDuckOthers()) {
+                v->Mix(acc.data(), (unsigned)acc.size(), playTime, 1.0f);
+                bDuck = bDuck || v->HasSignal();
+            }
+        const float duck = bDuck ? float(duckGain) : 1.0f;
+        for (const AudioVoicePtrTy& v: voices)
+            if (!v->IsDuckLatched())
+                v->Mix(acc.data(), (unsigned)acc.size(), playTime, duck);
+    }
+    cntMixed++;
+}
+
+// List of available OpenAL output devices
+std::vector<std::string> AudioMixerTy::EnumDevices ()
+{
+    std::vector<std::string> v;
+    // a list of null-terminated strings, ending with an empty one
+    const ALCchar* s = alcGetString(nullptr, ALC_ALL_DEVICES_SPECIFIER);
+    if (!s)
+        s = alcGetString(nullptr, ALC_DEVICE_SPECIFIER);
+    for (; s && *s; s += strlen(s) + 1)
+        v.emplace_back(s);
+    return v;
+}
@@ -33,9 +33,8 @@
 //
 
 // one COM channel per COM channel - obviously ;)
-COMChannel gChn[COM_CNT] = {
-    {0}, {1}
-};
+// (created on demand, a deque never moves existing elements)
+std::deque<COMChannel> gChn;
 
 /// Static arguments passed to the VLC initialization
 const char* vlcArgs[] = {
@@ -54,6 +53,25 @@ std::unique_ptr<VLC::Instance> gVLCInst;
 /// List of available output devices
 std::vector<VLC::AudioOutputDeviceDescription> gVLCOutputDevs;
 
+/// Background initialization of the VLC instance
+std::future<bool> futVLCInit;
+/// Output devices found by the background initialization
+std::vector<VLC::AudioOutputDeviceDescription> vlcInitDevs;
+/// When did the background initialization start?
+std::chrono::time_point<std::chrono::steady_clock> tVLCInitStart;
+
+// VLC initialized and ready?
+bool COMChannel::bVLCReady = false;
+
+// Number of warm streams of all channels
+std::atomic<int> COMChannel::cntWarmAll{0};
+
+// the one and only stream reaper
+StreamReaperTy gReaper;
+
+// registry of shared media players
+StreamShareTy gShares;
+
 //
 // MARK: Global VLC functions
 //
@@ -114,6 +132,27 @@ std::string GetStatusStr (StreamStatusTy s)
     }
 }
 
+// Can the airport's station be received from the plane's position?
+bool LiveATCDataTy::IsInReach (const positionTy& planePos, double* pDist_nm) const
+{
+    if (std::isnan(airportPos.lat()))
+        return false;
+    const double dist_nm = planePos.dist(airportPos) / M_per_NM;
+    if (pDist_nm)
+        *pDist_nm = dist_nm;
+    if (dist_nm > dataRefs.GetRadioReach_nm(planePos, airportPos))
+        return false;
+    
+    // optionally: is the station masked by terrain?
+    if (dataRefs.ShallCheckTerrainLOS() &&
+        gLOS.Query(airportIcao, planePos, airportPos) == LOS_BLOCKED)
+    {
+        LOG_MSG(logDEBUG, DBG_AP_LOS_BLOCKED, airportIcao.c_str(), dist_nm);
+        return false;
+    }
+    return true;
+}
+
 // save the new frequency
 void StreamCtrlTy::SetFrequ(int f)
 {
@@ -125,6 +164,242 @@ void StreamCtrlTy::SetFrequ(int f)
     frequString = buf;
 }
 
+//
+// MARK: Stream reaper
+//
+
+// Start the reaper thread
+void StreamReaperTy::Start ()
+{
+    if (thr.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = false;
+    }
+    thr = std::thread(&StreamReaperTy::Run, this);
+}
+
+// Reap everything handed over, then stop the reaper thread
+void StreamReaperTy::Stop ()
+{
+    if (!thr.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cv.notify_all();
+    thr.join();
+    LogStats();
+}
+
+// Wait till all handed over media players are destroyed
+void StreamReaperTy::Drain ()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this]{ return !thr.joinable() || (corpses.empty() && !bBusy); });
+}
+
+// Take over a media player, its media, and feed
+void StreamReaperTy::HandOver (MediaPlayerPtrTy&& pMP,
+                               MediaPtrTy&& pMedia,
+                               AudioFeedPtrTy&& pFeed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (thr.joinable() && !bStop) {
+            corpses.push_back({std::move(pMP), std::move(pMedia), std::move(pFeed)});
+            cv.notify_all();
+            return;
+        }
+    }
+    // no reaper running: do it ourselves, blocking
+    if (pMP)
+        pMP->stop();
+    pMP = nullptr;
+    pMedia = nullptr;
+    pFeed = nullptr;
+}
+
+// Record time spent in a stop path
+void StreamReaperTy::RecordStop (std::chrono::steady_clock::duration d)
+{
+    const double ms = std::chrono::duration<double,std::milli>(d).count();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        cntStop++;
+        sumStopMs += ms;
+        maxStopMs = std::max(maxStopMs, ms);
+        if (ms <= REAPER_STOP_BOUND_MS)
+            return;
+        cntStopSlow++;
+    }
+    LOG_MSG(logDEBUG, DBG_STOP_SLOW, ms, REAPER_STOP_BOUND_MS);
+}
+
+// Log statistics
+void StreamReaperTy::LogStats ()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!cntStop && !cntReaped)
+        return;
+    LOG_MSG(logINFO, MSG_REAPER_STATS, cntReaped, maxReapMs,
+            maxStopMs, cntStop ? sumStopMs / cntStop : 0.0,
+            cntStopSlow, REAPER_STOP_BOUND_MS);
+}
+
+/// Stops and destroys media players one after the other.
+/// When asked to stop it still reaps all remaining ones before exiting.
+void StreamReaperTy::Run ()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+        cv.wait(lock, [this]{ return bStop || !corpses.empty(); });
+        if (corpses.empty())                // implies bStop
+            break;
+        
+        // take the oldest one and reap it outside the lock
+        CorpseTy c = std::move(corpses.front());
+        corpses.pop_front();
+        bBusy = true;
+        lock.unlock();
+        const std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+        if (c.pMP)
+            c.pMP->stop();
+        c.pMP = nullptr;
+        c.pMedia = nullptr;
+        c.pFeed = nullptr;
+        const double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        lock.lock();
+        bBusy = false;
+        cntReaped++;
+        maxReapMs = std::max(maxReapMs, ms);
+        cv.notify_all();                    // might wake up Drain()
+    }
+}
+
+//
+// MARK: Media player with events
+//
+
+/// The libVLC events we subscribe to
+static const libvlc_event_type_t PLAYER_EVENTS[] = {
+    libvlc_MediaPlayerOpening,
+    libvlc_MediaPlayerBuffering,
+    libvlc_MediaPlayerPlaying,
+    libvlc_MediaPlayerStopped,
+    libvlc_MediaPlayerEndReached,
+    libvlc_MediaPlayerEncounteredError,
+};
+
+// Creates the player and subscribes to its events
+PlayerTy::PlayerTy (VLC::Instance& inst) :
+VLC::MediaPlayer(inst)
+{
+    for (std::atomic<COMChannel*>& p: notify)
+        p = nullptr;
+    libvlc_event_manager_t* pEM = libvlc_media_player_event_manager(get());
+    for (libvlc_event_type_t t: PLAYER_EVENTS)
+        libvlc_event_attach(pEM, t, cbEvent, this);
+}
+
+// Unsubscribes from events
+PlayerTy::~PlayerTy ()
+{
+    libvlc_event_manager_t* pEM = libvlc_media_player_event_manager(get());
+    for (libvlc_event_type_t t: PLAYER_EVENTS)
+        libvlc_event_detach(pEM, t, cbEvent, this);
+}
+
+// Have the channel informed about events
+void PlayerTy::Notify (COMChannel* pChn)
+{
+    notify[size_t(pChn->GetIdx())] = pChn;
+}
+
+/// Only sets atomics and posts jobs, must not call back into libVLC.
+/// Buffering events come in quickly, they only update the progress.
+void PlayerTy::cbEvent (const libvlc_event_t* ev, void* data)
+{
+    PlayerTy& p = *static_cast<PlayerTy*>(data);
+    switch (ev->type) {
+        case libvlc_MediaPlayerOpening:
+            p.bufPct = 0.0f;
+            p.state = PLAYER_OPENING;
+            return;
+        case libvlc_MediaPlayerBuffering:
+            p.bufPct = ev->u.media_player_buffering.new_cache;
+            if (p.state < PLAYER_BUFFERING)
+                p.state = PLAYER_BUFFERING;
+            return;
+        case libvlc_MediaPlayerStopped:
+            p.state = PLAYER_STOPPED;
+            return;
+        case libvlc_MediaPlayerPlaying:
+            p.state = PLAYER_PLAYING;
+            break;
+        case libvlc_MediaPlayerEndReached:
+            p.state = PLAYER_ENDED;
+            break;
+        case libvlc_MediaPlayerEncounteredError:
+            p.state = PLAYER_ERROR;
+            break;
+        default:
+            return;
+    }
+    for (const std::atomic<COMChannel*>& pChn: p.notify)
+        if (COMChannel* c = pChn.load())
+            c->NotifyPlayerEvent();
+}
+
+//
+// MARK: Shared media players
+//
+
+// Offer a playing media player for sharing
+void StreamShareTy::Publish (const std::string& url, const SharedTy& sh)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    mapShared[url] = EntryTy{sh.pMP, sh.pMedia, sh.pFeed};
+}
+
+/// Only players with a feed qualify, i.e. those playing through the mixer
+StreamShareTy::SharedTy StreamShareTy::Join (const std::string& url)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    const auto iter = mapShared.find(url);
+    if (iter == mapShared.end())
+        return SharedTy();
+    SharedTy sh{iter->second.pMP.lock(), iter->second.pMedia.lock(), iter->second.pFeed.lock()};
+    if (!sh.pMP || !sh.pMedia || !sh.pFeed || sh.pMP->HasFailed()) {
+        mapShared.erase(iter);
+        return SharedTy();
+    }
+    cntJoined++;
+    return sh;
+}
+
+/// References to shared players are only ever added or dropped under the lock,
+/// so the reference count tells reliably if others still use the player.
+bool StreamShareTy::Leave (MediaPlayerPtrTy& pMP, MediaPtrTy& pMedia, AudioFeedPtrTy& pFeed)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (pMP && pMP.use_count() > 1) {
+        pMP = nullptr;
+        pMedia = nullptr;
+        pFeed = nullptr;
+        return false;
+    }
+    // we are the last one: unlist the player
+    for (auto iter = mapShared.begin(); iter != mapShared.end(); ++iter)
+        if (pMP && iter->second.pMP.lock() == pMP) {
+            mapShared.erase(iter);
+            break;
+        }
+    return true;
+}
+
 //
 // MARK: Helper structs
 //
@@ -132,16 +407,20 @@ void StreamCtrlTy::SetFrequ(int f)
 /// Stream's status, decides all but STREAM_SEARCHING (see COMChannel::GetStatus())
 StreamStatusTy StreamCtrlTy::GetStatus() const
 {
-    // not initialized at all?
-    if (!IsValid())
+    // VLC not initialized at all?
+    if (!gVLCInst)
         return STREAM_NOT_INIT;
     
+    // VLC reported an error or the end of the stream?
+    if (pMedia && pMP && pMP->HasFailed())
+        return STREAM_NOT_PLAYING;
+    
     // Is desync period still running?
     if (IsDesyncing())
         return STREAM_DESYNCING;
 
     // playing a stream, i.e. emmitting sound?
-    if (pMP->isPlaying()) {
+    if (pMP && pMP->IsPlaying()) {
         return bMute ? STREAM_MUTED : STREAM_PLAYING;
     }
     
@@ -162,17 +441,30 @@ StreamStatusTy StreamCtrlTy::GetStatus() const
 // MARK: Determine new stream URL to play
 //
 
-/// 1. Queries LiveATC.net with defined frequency using HttpGet()
+/// 1. Queries LiveATC.net with defined frequency using HttpGet(),
+///    unless the prefetch has that search page already
 /// 2. Parses the resulting web page for airport-specific streams (ParseForAirportStreams())
 /// 3. Finds the airport closest to current location (FindClosestAirport())
 /// 4. If an airport-stream is in reach copies its data into `curr`
-bool StreamCtrlTy::FetchUrlForFrequ ()
+///
+/// Prefetched streams only know the prefetched airports, not all airports
+/// sharing the frequency, so they are used only if LiveATC can't be reached.
+bool StreamCtrlTy::FetchUrlForFrequ (const positionTy& planePos)
 {
     // ask LiveATC, fills readBuf
     // put together the url
     char url[100];
     snprintf(url, sizeof(url), LIVE_ATC_URL, frequString.c_str());
-    if (!HttpGet(url, readBuf)) {
+    if (!gPrefetch.LookupSearch(frequString, readBuf) &&
+        !HttpGet(url, readBuf)) {
+        // flight plan prefetch might have found the streams before
+        if (gPrefetch.LookupFrequ(frequString, mapAirportStream)) {
+            const LiveATCDataMapTy::iterator apIter = FindClosestAirport(planePos);
+            if (apIter != mapAirportStream.end()) {
+                SelectAirport(apIter->second);
+                return true;
+            }
+        }
         // HTTP went wrong, clear this channel for now so we don't try again without the user doing someting
         StopAndClear();
         return false;
@@ -184,12 +476,53 @@ bool StreamCtrlTy::FetchUrlForFrequ ()
         return false;
     
     // find closest airport in mapAirportStream
-    const LiveATCDataMapTy::iterator apIter = FindClosestAirport();
+    const LiveATCDataMapTy::iterator apIter = FindClosestAirport(planePos);
     if (apIter == mapAirportStream.end())
         return false;
     
     // found an airport, use that data from now on
-    CopyFrom(apIter->second);
+    SelectAirport(apIter->second);
+    return true;
+}
+
+/// Expects one "ICAO:" section of a LiveATC search result page,
+/// fills airport, stream name, play URL and number of facilities.
+/// Streams, which are not UP, are skipped.
+bool ParseFeedSection (const std::string& apSec, LiveATCDataTy& streamData)
+{
+    std::smatch m;
+    
+    // identify information in the LiveATC reply
+    static std::regex reIcao ( R"#(<tr><td><strong>ICAO: </strong>(\w\w\w\w)<strong>)#" );
+    static std::regex reName ( R"#(<td bgcolor="lightblue"><strong>(.+?)</strong>)#" );
+    static std::regex reStat ( R"#(<tr><td><strong>Feed Status:</strong> <font color=\\?"\w+\\?"><strong>(\w+)</strong>)#" );
+    static std::regex reUrl  ( R"#(<a href="(.+?)" onClick=)#" );
+    
+    if (!std::regex_search(apSec, m, reIcao))       { LOG_MSG(logWARN, WARN_RE_ICAO, "airport ICAO"); return false; }
+    streamData.airportIcao = { m[1].str() };
+    
+    if (!std::regex_search(apSec, m, reName))       { LOG_MSG(logWARN, WARN_RE_ICAO, "stream name"); return false; }
+    streamData.streamName = m[1].str();
+    
+    // is stream not UP?
+    if (!std::regex_search(apSec, m, reStat))       { LOG_MSG(logWARN, WARN_RE_ICAO, "stream status"); /* assume UP */ }
+    else if (m[1] != "UP")
+    { LOG_MSG(logDEBUG, DBG_STREAM_NOT_UP, streamData.streamName.c_str(), m[1].str().c_str()); return false; }
+    
+    // URL to play, most likely just relative to the current server but not an absolute URL
+    if (!std::regex_search(apSec, m, reUrl))        { LOG_MSG(logWARN, WARN_RE_ICAO, "stream URL"); return false; }
+    streamData.playUrl = m[1].str();
+    if (streamData.playUrl.substr(0,4) != "http")
+        streamData.playUrl = std::string(LIVE_ATC_BASE) + streamData.playUrl;
+    
+    // count tables rows in facilities table
+    std::string::size_type pos = apSec.find("<table class=\"freqTable\"");
+    if (pos != std::string::npos) {
+        for (pos = apSec.find("<tr><td class=\"td", pos+1);
+             pos != std::string::npos;
+             pos = apSec.find("<tr><td class=\"td", pos+1),
+             streamData.nFacilities++);
+    }
     return true;
 }
 
@@ -201,50 +534,18 @@ void StreamCtrlTy::ParseForAirportStreams ()
     
     // pass over the readBuffer, airport section by airport section
     for (std::string::size_type
-         pos = readBuf.find("<tr><td><strong>ICAO:"),
+         pos = readBuf.find(LIVE_ATC_SECTION),
          nextPos = std::string::npos;
          pos != std::string::npos;
          pos = nextPos)
     {
         // find the next airport thereafter, so we know the section we are working on
-        nextPos = readBuf.find("<tr><td><strong>ICAO:", pos+1);
+        nextPos = readBuf.find(LIVE_ATC_SECTION, pos+1);
         
         // the section we really work on now
-        const std::string apSec(readBuf.substr(pos, nextPos-pos));
-        std::smatch m;
-        
-        // identify information in the LiveATC reply
         LiveATCDataTy streamData;
-        static std::regex reIcao ( R"#(<tr><td><strong>ICAO: </strong>(\w\w\w\w)<strong>)#" );
-        static std::regex reName ( R"#(<td bgcolor="lightblue"><strong>(.+?)</strong>)#" );
-        static std::regex reStat ( R"#(<tr><td><strong>Feed Status:</strong> <font color=\\?"\w+\\?"><strong>(\w+)</strong>)#" );
-        static std::regex reUrl  ( R"#(<a href="(.+?)" onClick=)#" );
-        
-        if (!std::regex_search(apSec, m, reIcao))       { LOG_MSG(logWARN, WARN_RE_ICAO, "airport ICAO"); continue; }
-        streamData.airportIcao = { m[1].str() };
-        
-        if (!std::regex_search(apSec, m, reName))       { LOG_MSG(logWARN, WARN_RE_ICAO, "stream name"); continue; }
-        streamData.streamName = m[1].str();
-        
-        // is stream not UP?
-        if (!std::regex_search(apSec, m, reStat))       { LOG_MSG(logWARN, WARN_RE_ICAO, "stream status"); /* assume UP */ }
-        else if (m[1] != "UP")
-        { LOG_MSG(logDEBUG, DBG_STREAM_NOT_UP, streamData.streamName.c_str(), m[1].str().c_str()); continue; }
-        
-        // URL to play, most likely just relative to the current server but not an absolute URL
-        if (!std::regex_search(apSec, m, reUrl))        { LOG_MSG(logWARN, WARN_RE_ICAO, "stream URL"); continue; }
-        streamData.playUrl = m[1].str();
-        if (streamData.playUrl.substr(0,4) != "http")
-            streamData.playUrl = std::string(LIVE_ATC_BASE) + streamData.playUrl;
-        
-        // count tables rows in facilities table
-        pos = apSec.find("<table class=\"freqTable\"");
-        if (pos != std::string::npos) {
-            for (pos = apSec.find("<tr><td class=\"td", pos+1);
-                 pos != std::string::npos;
-                 pos = apSec.find("<tr><td class=\"td", pos+1),
-                 streamData.nFacilities++);
-        }
+        if (!ParseFeedSection(readBuf.substr(pos, nextPos-pos), streamData))
+            continue;
         
         // is such an airport already in our map?
         LiveATCDataMapTy::iterator mapIter = mapAirportStream.find(streamData.airportIcao);
@@ -270,42 +571,48 @@ void StreamCtrlTy::ParseForAirportStreams ()
 
 
 // find closest airport in mapAirportStream
-LiveATCDataMapTy::iterator StreamCtrlTy::FindClosestAirport()
+LiveATCDataMapTy::iterator StreamCtrlTy::FindClosestAirport(const positionTy& planePos)
 {
     // Sanity check...there must be any for us to find one
     if (mapAirportStream.empty())
         return mapAirportStream.end();
     
-    // plane's position
-    const positionTy planePos = dataRefs.GetUsersPlanePos();
-    
     // loop airports in mapAirportStream and for each of it
     // determine distance to plane, remember the closest airport
     LiveATCDataMapTy::iterator closestAirport = mapAirportStream.end();
     double closestDist_nm = dataRefs.GetMaxRadioDist();    // with this init we will not consider airports father away
+    double dist_nm = NAN;
     for (LiveATCDataMapTy::iterator iter = mapAirportStream.begin();
          iter != mapAirportStream.end();
          )
     {
         // if we don't know the airport's position yet
         LiveATCDataTy& atcData = iter->second;
+        bool bPending = false;
         if (std::isnan(atcData.airportPos.lat())) {
-            // find that airport in X-Plane's nav database
-            float lat = NAN, lon = NAN, alt_m = NAN;
-            XPLMNavRef apRef = XPLMFindNavAid(NULL, iter->first.c_str(), NULL, NULL, NULL, xplm_Nav_Airport);
-            if (apRef) {
-                XPLMGetNavAidInfo(apRef, NULL, &lat, &lon, &alt_m, NULL, NULL, NULL, NULL, NULL);
-                atcData.airportPos = positionTy (lat, lon, alt_m);
-            }
+            // find that airport in our copy of X-Plane's nav database
+            atcData.airportPos = gAirports.Find(iter->first, &bPending);
         }
         
-        if (!std::isnan(atcData.airportPos.lat())) {
-            // check current distance to airport and if it is the closest seen so far
-            double dist_nm = planePos.dist(atcData.airportPos) / M_per_NM;
-            if (dist_nm < closestDist_nm) {
+        if (bPending) {
+            // lookup not yet answered, try again next time
+            iter++;
+        } else if (!std::isnan(atcData.airportPos.lat())) {
+            // check if airport is in radio reach and if it is the closest seen so far
+            // (log only when the airport moves out of reach)
+            const bool bReach = atcData.IsInReach(planePos, &dist_nm);
+            if (!bReach) {
+                if (atcData.bInReach &&
+                    dist_nm > dataRefs.GetRadioReach_nm(planePos, atcData.airportPos)) {
+                    LOG_MSG(logDEBUG, DBG_AP_NOT_IN_REACH, iter->first.c_str(), dist_nm,
+                            dataRefs.GetRadioReach_nm(planePos, atcData.airportPos));
+                }
+            }
+            else if (dist_nm < closestDist_nm) {
                 closestDist_nm = dist_nm;
                 closestAirport = iter;
             }
+            atcData.bInReach = bReach;
             // then try next airport
             iter++;
         } else {
@@ -319,20 +626,86 @@ LiveATCDataMapTy::iterator StreamCtrlTy::FindClosestAirport()
     return closestAirport;
 }
 
+// Take over the airport stream data and remember when this selection happened
+void StreamCtrlTy::SelectAirport (const LiveATCDataTy& apData)
+{
+    CopyFrom(apData);
+    apSelected = std::chrono::steady_clock::now();
+}
+
+// Seconds since the current airport stream was selected
+int StreamCtrlTy::GetSecSinceAirportSelected () const
+{
+    return int(std::chrono::duration_cast<std::chrono::seconds>
+               (std::chrono::steady_clock::now() - apSelected).count());
+}
+
+/// With the mixer the voice delays the audio itself,
+/// otherwise VLC is asked to delay the audio.
 void StreamCtrlTy::SetAudioDesync (long desyncSecs)
 {
     // set audio desync (microseconds!)
-    pMP->setAudioDelay(int64_t(desyncSecs) * 1000000L);
+    desyncSecsWanted = desyncSecs;
+    if (pVoice) {
+        const int64_t us = pVoice->SetDelay(int64_t(desyncSecs) * 1000000L);
+        if (us < int64_t(desyncSecs) * 1000000L) {
+            LOG_MSG(logWARN, WARN_AUDIO_BUF_MAX, desyncSecs,
+                    dataRefs.GetAudioBufMaxKB(), long(us / 1000000L));
+            desyncSecs = long(us / 1000000L);
+        }
+    }
+    else if (pMP)
+        pMP->setAudioDelay(int64_t(desyncSecs) * 1000000L);
+    desyncSecsSet = desyncSecs;
     // set the desync timer
     desyncDone = std::chrono::steady_clock::now() +
     std::chrono::seconds(desyncSecs);
 }
 
+/// A countdown still running is shifted by the change,
+/// with a voice it follows the voice's fill level anyway.
+/// A period beyond the buffer limit is logged once, and then
+/// not tried again until the period asked for changes.
+bool StreamCtrlTy::RetargetDesync (long desyncSecs)
+{
+    if (!pMedia || !pMP || std::abs(desyncSecs - desyncSecsWanted) < CHN_DESYNC_RETARGET_S)
+        return false;
+    desyncSecsWanted = desyncSecs;
+    if (pVoice) {
+        const int64_t us = pVoice->SetDelay(int64_t(desyncSecs) * 1000000L);
+        if (us < int64_t(desyncSecs) * 1000000L) {
+            LOG_MSG(logWARN, WARN_AUDIO_BUF_MAX, desyncSecs,
+                    dataRefs.GetAudioBufMaxKB(), long(us / 1000000L));
+            desyncSecs = long(us / 1000000L);
+        }
+    }
+    else
+        pMP->setAudioDelay(int64_t(desyncSecs) * 1000000L);
+    if (desyncSecs == desyncSecsSet)
+        return false;
+    if (desyncDone > std::chrono::steady_clock::now())
+        desyncDone += std::chrono::seconds(desyncSecs - desyncSecsSet);
+    desyncSecsSet = desyncSecs;
+    return true;
+}
+
+/// The timer is just a guess. With a voice we know better:
+/// The countdown only proceeds while audio is actually buffered.
+std::chrono::time_point<std::chrono::steady_clock> StreamCtrlTy::GetDesyncDone () const
+{
+    // timer cleared or no voice delaying the audio?
+    if (desyncDone == std::chrono::time_point<std::chrono::steady_clock>() ||
+        !pVoice || pVoice->GetDelay() <= 0)
+        return desyncDone;
+    return std::chrono::steady_clock::now() +
+    std::chrono::microseconds(pVoice->GetDesyncRemainUs());
+}
+
 // return number of seconds till desync should be done
 int StreamCtrlTy::GetSecTillDesyncDone () const
 {
     return int(std::chrono::duration_cast<std::chrono::seconds>
-               (desyncDone - std::chrono::steady_clock::now()).count());
+               (GetDesyncDone() - std::chrono::steady_clock::now()).count());
 }
 
 void StreamCtrlTy::SetVolume(int v, bool bUnMute)
@@ -347,8 +720,7 @@ void StreamCtrlTy::SetVolume(int v, bool bUnMute)
         bMute = false;
 
         // set volume
-        if (pMP)
-            pMP->setVolume(volume);
+        ApplyVolume();
     }
 }
 
@@ -356,14 +728,120 @@ void StreamCtrlTy::SetVolume(int v, bool bUnMute)
 void StreamCtrlTy::SetMute(bool mute)
 {
     bMute = mute;
-    if (pMP)
-        pMP->setVolume(bMute ? 0 : volume);
+    ApplyVolume();
+}
+
+// Record the stream's audio into this history
+void StreamCtrlTy::SetRecorder(ReplayRingTy* r)
+{
+    if (pVoice)
+        pVoice->SetRecorder(r);
+}
+
+// Duck other channels while this stream carries a signal?
+void StreamCtrlTy::SetDuckOthers(bool b)
+{
+    bDuckOthers = b;
+    ApplyVolume();
+}
+
+/// With the mixer active gain is only applied by the mixer, which ramps
+/// to it without clicks, VLC's software volume stays at 100%.
+/// Nothing is passed on if nothing changed.
+void StreamCtrlTy::ApplyVolume (bool bForce)
+{
+    const int v = bMute ? 0 : volume;
+    if (!bForce && v == appliedVol && bDuckOthers == appliedDuck)
+        return;
+    if (pVoice) {
+        pVoice->SetGain(float(v) / 100.0f);
+        pVoice->SetDuckOthers(bDuckOthers);
+    }
+    else if (pMP)
+        pMP->setVolume(v);
+    else
+        return;
+    appliedVol = v;
+    appliedDuck = bDuckOthers;
+}
+
+/// Static rises with the square of the distance
+/// relative to the radio reach, getting noticeable only well away.
+void StreamCtrlTy::ApplyRadioFx (const positionTy& planePos)
+{
+    if (!pVoice)
+        return;
+    float lvl = 0.0f;
+    if (!std::isnan(airportPos.lat())) {
+        const double reach_nm = dataRefs.GetRadioReach_nm(planePos, airportPos);
+        const double frac = reach_nm > 0.0 ?
+            std::clamp(planePos.dist(airportPos) / M_per_NM / reach_nm, 0.0, 1.0) : 1.0;
+        lvl = AUDIO_FX_STATIC_MAX * float(frac * frac);
+    }
+    pVoice->SetRadioFx(dataRefs.ShallApplyRadioFx(), lvl);
+}
+
+// Create the media player if there is none yet
+bool StreamCtrlTy::EnsurePlayer ()
+{
+    if (!pMP && gVLCInst) {
+        pMP = std::make_shared<PlayerTy>(*gVLCInst);
+        ApplyVolume(true);
+    }
+    return bool(pMP);
+}
+
+/// The feed's ring is as large as the configured maximum buffer size allows,
+/// so that the desync period can grow later without restarting the stream,
+/// also for other channels sharing the feed.
+/// A shared player comes with its feed already, then only the voice is added.
+/// The delay is set right away so that no early sample slips through.
+void StreamCtrlTy::AttachVoice (long desyncSecs)
+{
+    if (!gMixer.IsActive() || !pMP)
+        return;
+    if (!pFeed) {
+        pFeed = std::make_shared<AudioFeedTy>(std::numeric_limits<long>::max(),
+                                              dataRefs.ShallCompressAudioBuf() ? AUDIO_ENC_ULAW : AUDIO_ENC_PCM16,
+                                              size_t(dataRefs.GetAudioBufMaxKB()) * 1024);
+        pFeed->Attach(*pMP);
+    }
+    if (!pVoice) {
+        pVoice = std::make_shared<AudioVoiceTy>(pFeed);
+        ApplyVolume(true);
+        gMixer.Add(pVoice);
+    }
+    pVoice->SetDelay(int64_t(std::max(desyncSecs, 0L)) * 1000000L);
+}
+
+/// A shared media player keeps playing for the others,
+/// only the last one hands it over to the reaper.
+void StreamCtrlTy::ReleasePlayer ()
+{
+    if (pVoice)
+        gMixer.Remove(pVoice);
+    pVoice = nullptr;
+    desyncSecsSet = desyncSecsWanted = 0;
+    if (gShares.Leave(pMP, pMedia, pFeed))
+        gReaper.HandOver(std::move(pMP), std::move(pMedia), std::move(pFeed));
+}
+
+// While buffering, the player's progress is added
+std::string StreamCtrlTy::Summary (StreamStatusTy eStatus) const
+{
+    const StreamStatusTy s = eStatus ? eStatus : GetStatus();
+    std::string ret = LiveATCDataTy::Summary() + " (" + GetStatusStr(s);
+    if (s == STREAM_BUFFERING && pMP && pMP->GetBufferingPct() > 0.0f)
+        ret += ' ' + std::to_string(int(pMP->GetBufferingPct())) + '%';
+    return ret + ')';
 }
 
 void StreamCtrlTy::StopAndClear()
 {
-    // stop any stream in case something's running
-    pMP->stop();
+    // something was played? Then let the reaper stop it,
+    // a new media player is created once needed again
+    if (pMedia && pMP)
+        ReleasePlayer();
 
     // LiveATCDataTy
     airportIcao.clear();
@@ -377,11 +855,19 @@ void StreamCtrlTy::StopAndClear()
     frequString.clear();
     bStandbyPrebuf = false;
     mapAirportStream.clear();
+    desyncSecsSet = desyncSecsWanted = 0;
     
     // clear media
     pMedia = nullptr;
 }
 
+// Seconds since last use
+int WarmStreamTy::GetSecSinceUsed () const
+{
+    return int(std::chrono::duration_cast<std::chrono::seconds>
+               (std::chrono::steady_clock::now() - lastUsed).count());
+}
+
 //
 // MARK: Class representing one COM channel, which can run a VLC stream
 //
@@ -404,79 +890,645 @@ bool COMChannel::InitVLC()
     // just in case - cleanup in proper order
     CleanupVLC();
 
-    // (re)create media player
-    dataA.pMP = std::make_unique<VLC::MediaPlayer>(*gVLCInst);
-    dataB.pMP = std::make_unique<VLC::MediaPlayer>(*gVLCInst);
+    // media players are created by PlayStream() only once really needed
+    bVLCInit = true;
+    PublishStatus();
     return true;
 }
 
 // Cleans up the VLC smart pointers in a proper order
 void COMChannel::CleanupVLC()
 {
-    // async thread running? That's something we need to wait for (blocking!)
+    // async task running? That's something we need to wait for (blocking!)
     AbortAndWaitForAsync();
-    futVlcStart = std::future<void>();
     
-    // stop orderly
-    if (dataA.pMP && dataA.pMP->isPlaying())
-        dataA.pMP->stop();
-    if (dataB.pMP && dataB.pMP->isPlaying())
-        dataB.pMP->stop();
+    // drop commands not yet processed
+    ChnMsgTy msg;
+    while (cmdQueue.Pop(msg));
+    bCmdTaskPosted = false;
+    bActive = false;
+    postedFrequ = postedStandby = 0;
+    RemoveJobs();
     
-    // these are smart pointers, i.e. assigning nullptr destroys an assigned object properly
-    dataB.pMedia    = nullptr;
-    dataB.pMP       = nullptr;
-    dataA.pMedia    = nullptr;
-    dataA.pMP       = nullptr;
+    // stop orderly, the reaper stops and destroys the media players
+    bVLCInit = false;
+    ClearWarmPool();
+    StopReplay();
+    dataB.ReleasePlayer();
+    dataA.ReleasePlayer();
+    pReplay = nullptr;
+    bReplayTried = false;
+    PublishStatus();
 }
 
 // Is VLC properly initialized?
 bool COMChannel::IsValid() const
 {
-    return dataA.IsValid() && dataB.IsValid();
+    return bVLCInit;
+}
+
+
+/// Called from the flight loop, up to 10 times a second.
+/// Compares X-Plane's frequencies to what was posted before and
+/// posts tune and stand-by commands on change, and a regular tick if requested.
+/// A changed active frequency is only posted once it has been seen twice
+/// in a row as the pilot might still be turning the knob.
+bool COMChannel::RegularMaintenance (bool bTick)
+{
+    // not initialized? Media players are created on first use only
+    if (!IsValid()) {
+        if (!IsVLCReady() || !InitVLC())
+            return false;
+        LogResourceStats();
+    }
+    if (!bActive) {
+        StartJobs();
+        bActive = true;
+    }
+    bool bChanged = false;
+    
+    // *** COM frequency change ***
+    const int frequ = dataRefs.GetComFreq(idx);
+    if (frequ != postedFrequ) {
+        bChanged = true;
+        if (frequ == seenFrequ) {
+            // a running startup is outdated now
+            if (bStarting)
+                bAbortStart = true;
+            if (PostCmd(CHN_CMD_TUNE))
+                postedFrequ = frequ;
+        }
+    }
+    seenFrequ = frequ;
+    
+    // *** stand-by frequency change ***
+    const int frequStandby = dataRefs.GetComStandbyFreq(idx);
+    if (frequStandby != postedStandby) {
+        bChanged = true;
+        // a running pre-buffering is outdated now
+        if (bStarting && prioStart == WORK_STANDBY)
+            bAbortStart = true;
+        if (PostCmd(CHN_CMD_STANDBY))
+            postedStandby = frequStandby;
+        // pre-buffer once it stays stable
+        gTimers.Start(jobStby, CHN_STBY_STABLE_MS);
+    }
+    
+    // *** mute or transmit selection change ***
+    const bool bMute = dataRefs.IsMuted() || dataRefs.ShallMuteCom(idx);
+    const bool bTx = dataRefs.IsComTx(idx);
+    if ((bMute != postedMute || bTx != postedTx) && PostCmd(CHN_CMD_VOLUME)) {
+        postedMute = bMute;
+        postedTx = bTx;
+    }
+    
+    // *** regular checks ***
+    if (bTick)
+        PostCmd(CHN_CMD_TICK);
+    return bChanged;
+}
+
+// Is the channel busy tuning, buffering, or desyncing?
+bool COMChannel::IsTransitioning () const
+{
+    if (bStarting || bCmdTaskPosted)
+        return true;
+    const StreamStatusTy status = snapStatus.Read().status;
+    return
+        status == STREAM_SEARCHING ||
+        status == STREAM_BUFFERING ||
+        status == STREAM_DESYNCING;
+}
+
+// stop VLC, reset frequency
+void COMChannel::ClearChannel()
+{
+    // not initialized or not active?
+    if (!IsValid() || !bActive)
+        return;
+    StopTimerTy stopTimer;
+
+    // abort any startup, then have the executor stop all output
+    if (bStarting)
+        bAbortStart = true;
+    if (PostCmd(CHN_CMD_STOP)) {
+        gTimers.StopChn(idx);
+        bActive = false;
+        postedFrequ = postedStandby = 0;
+    }
+}
+
+// COM channel's status, mostly depends on `curr->GetStatus()` but takes StartStream() into consideration
+StreamStatusTy COMChannel::GetStatus() const
+{
+    // it actually _is_ the stream's status in all but one cases
+    StreamStatusTy streamStatus = curr->GetStatus();
+    
+    // There are some override cases:
+    
+    // If we are not playing then we might be actively searching:
+    if (streamStatus == STREAM_NOT_PLAYING)
+        return IsAsyncRunning() ? STREAM_SEARCHING : STREAM_NOT_PLAYING;
+
+    return streamStatus;
+}
+
+// Textual status summary for end user
+std::string COMChannel::Summary (bool bPrev) const
+{
+    const ChnStatusTy st = snapStatus.Read();
+    return bPrev ? st.summaryPrev : st.summary;
+}
+
+// Textual status summary for debug purposes
+std::string COMChannel::dbgStatus (bool bPrev) const
+{
+    return bPrev ? prev->dbgStatus() : curr->dbgStatus();
+}
+
+// Log switch and restart counts, also as rates per flight hour
+void COMChannel::LogSwitchStats () const
+{
+    if (statsStart == std::chrono::time_point<std::chrono::steady_clock>())
+        return;
+    const double hours = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - statsStart).count() / SEC_per_H;
+    LOG_MSG(logINFO, MSG_AP_SWITCH_STATS, idx+1,
+            cntApSwitch, cntApSwitchHold, cntRestart, hours,
+            hours > 0.0 ? cntApSwitch / hours : 0.0,
+            hours > 0.0 ? cntRestart  / hours : 0.0);
+}
+
+// Log hit rate of frequency predictions
+void COMChannel::LogPredictStats () const
+{
+    if (!cntPredict)
+        return;
+    LOG_MSG(logINFO, MSG_PREDICT_STATS, idx+1,
+            cntPredict, cntPredictHit, 100.0 * cntPredictHit / cntPredict,
+            predictSecs / SEC_per_M);
+}
+
+//
+// MARK: Static functions
+//
+
+/// Starts the background initialization and waits for it
+bool COMChannel::InitAllVLC()
+{
+    InitAllVLCAsync();
+    return CheckVLCInit(true);
+}
+
+/// Loading VLC's plugins can take seconds, which would otherwise
+/// add to X-Plane's loading time. The background thread creates
+/// the VLC instance and fetches the output devices, nothing else.
+/// Channels create their media players once VLC is ready and they are
+/// needed, see RegularMaintenance().
+void COMChannel::InitAllVLCAsync()
+{
+    // in case of a re-init we firstly stop orderly
+    // (this includes waiting for an initialization still running)
+    if (gVLCInst || futVLCInit.valid())
+        CleanupAllVLC();
+    
+    tVLCInitStart = std::chrono::steady_clock::now();
+    futVLCInit = std::async(std::launch::async, []{
+        // create global VLC instance
+        if (!CreateVLCInstance())
+            return false;
+        // fetch all possible output devices
+        vlcInitDevs = VLC::MediaPlayer(*gVLCInst).outputDeviceEnum();
+        return true;
+    });
+}
+
+/// Called regularly from the flight loop till done
+bool COMChannel::CheckVLCInit (bool bWait)
+{
+    // nothing running or not yet done?
+    if (!futVLCInit.valid() ||
+        (!bWait && futVLCInit.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+        return false;
+    
+    // failed?
+    if (!futVLCInit.get()) {
+        CleanupVLCInstance();
+        return false;
+    }
+    
+    // take over the results, from now on channels can start
+    gVLCOutputDevs = std::move(vlcInitDevs);
+    vlcInitDevs.clear();
+    bVLCReady = true;
+    LOG_MSG(logINFO, MSG_VLC_INIT_DONE,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - tVLCInitStart).count(),
+            int(gVLCOutputDevs.size()));
+    return true;
+}
+
+// static function: stop still running VLC instances
+void COMChannel::StopAll()
+{
+    for (COMChannel& chn: gChn)
+        chn.ClearChannel();
+}
+
+// Cleanup *all* VLC instances, also stops all playback
+void COMChannel::CleanupAllVLC()
+{
+    // an initialization still running needs to finish first
+    CheckVLCInit(true);
+    bVLCReady = false;
+    
+    // cleanup the channels
+    if (!gChn.empty())
+        LogResourceStats();
+    for (COMChannel& chn: gChn) {
+        chn.LogSwitchStats();
+        chn.LogPredictStats();
+        chn.CleanupVLC();
+    }
+    
+    // all media players must be gone before the VLC instance
+    gReaper.Drain();
+    
+    // cleanup the central VLC instance object
+    CleanupVLCInstance();
+}
+
+// Update list of available audio devices
+void COMChannel::UpdateVLCOutputDevices()
+{
+    if (!IsVLCReady())
+        return;
+    gVLCOutputDevs.clear();
+    
+    // use a temporary MediaPlayer instance to do so
+    // (the channels' players belong to their executors)
+    gVLCOutputDevs = VLC::MediaPlayer(*gVLCInst).outputDeviceEnum();
+}
+
+// Set all MediaPlayer to use the given audio device
+void COMChannel::SetAllAudioDevice(const std::string& devId)
+{
+    // with the mixer active there is just one output to switch
+    if (gMixer.IsActive())
+        gMixer.SetDevice(devId);
+    
+    // the device is passed on as part of the channel's input
+    for (COMChannel& chn : gChn)
+        if (chn.IsValid())
+            chn.PostCmd(CHN_CMD_AUDIO_DEV);
+}
+
+
+// "Say again": replay the last transmission received on a channel
+void COMChannel::SayAgain (int i)
+{
+    COMChannel* pChn = Get(i);
+    if (pChn && pChn->IsValid())
+        pChn->PostCmd(CHN_CMD_REPLAY);
+}
+
+// Set the volume of all playback streams
+void COMChannel::SetAllVolume(int vol)
+{
+    LOG_MSG(logDEBUG, DBG_VLC_VOLUME, vol);
+    for (COMChannel& chn : gChn)
+        if (chn.IsValid())
+            chn.PostCmd(CHN_CMD_VOLUME);
+}
+
+// (un)Mute all playback streams
+void COMChannel::MuteAll(bool bDoMute)
+{
+    LOG_MSG(logDEBUG, bDoMute ? DBG_VLC_MUTE : DBG_VLC_UNMUTE);
+    for (COMChannel& chn : gChn)
+        if (chn.IsValid())
+            chn.PostCmd(CHN_CMD_VOLUME);
+}
+
+// Returns the channel object, optionally creating it
+COMChannel* COMChannel::Get (int i, bool bCreate)
+{
+    if (i < 0 || i >= dataRefs.GetComCnt())
+        return nullptr;
+    if (i >= (int)gChn.size()) {
+        if (!bCreate)
+            return nullptr;
+        // channel objects are cheap, media players are created on first use
+        while ((int)gChn.size() <= i)
+            gChn.emplace_back((int)gChn.size());
+    }
+    return &gChn[i];
+}
+
+// Textual status summary of a channel, empty if the channel does not exist
+std::string COMChannel::GetSummary (int i, bool bPrev)
+{
+    const COMChannel* pChn = Get(i);
+    return pChn ? pChn->Summary(bPrev) : std::string();
+}
+
+// Log resources used by all channels
+void COMChannel::LogResourceStats ()
+{
+    int nPlayers = 0, nStreams = 0;
+    unsigned long bufBytes = 0;
+    for (const COMChannel& chn: gChn) {
+        const ChnStatusTy st = chn.GetStatusSnapshot();
+        nPlayers += st.nPlayers;
+        bufBytes += st.bufBytes;
+        if (st.status >= STREAM_BUFFERING)
+            nStreams++;
+    }
+    LOG_MSG(logINFO, MSG_CHN_RESOURCES,
+            dataRefs.GetComCnt(), (int)gChn.size(),
+            nPlayers, bufBytes / 1024, gShares.GetJoinedCnt(),
+            nStreams, int(cntWarmAll), gWorkers.GetThreadCnt());
+}
+
+// checks if any channel requires X-Plane's ATIS to be suppressed
+bool COMChannel::AnyXPAtisSuppressed()
+{
+    for (const COMChannel& chn : gChn)
+        if (chn.bSuppressXPAtis)
+            return true;
+    return false;
+}
+
+//
+// MARK: Posting commands (main thread)
+//
+
+// Collect X-Plane's current state for this channel
+ChnInputTy COMChannel::GetInput () const
+{
+    ChnInputTy in;
+    in.frequ        = dataRefs.GetComFreq(idx);
+    in.frequStandby = dataRefs.GetComStandbyFreq(idx);
+    in.planePos     = dataRefs.GetUsersPlanePos();
+    in.desyncSecs   = dataRefs.GetDesyncPeriod();
+    in.volume       = dataRefs.GetVolume();
+    in.bMute        = dataRefs.IsMuted() || dataRefs.ShallMuteCom(idx);
+    in.bTx          = dataRefs.IsComTx(idx);
+    in.audioDev     = dataRefs.GetAudioDev();
+    in.phase        = gPhase.GetPhase();
+    return in;
+}
+
+/// Pushes the command to the lock-free queue, and posts a task
+/// to process the queue unless one is already waiting.
+bool COMChannel::PostCmd (ChnCmdTy cmd)
+{
+    if (!cmdQueue.Push({cmd, GetInput()}))
+        return false;
+    if (!bCmdTaskPosted.exchange(true))
+        gWorkers.Post(WORK_CONTROL, idx, [this]{ ProcessCmds(); });
+    return true;
+}
+
+//
+// MARK: State machine (executor)
+//
+
+// Process all queued commands
+void COMChannel::ProcessCmds ()
+{
+    // from now on new commands need a new task
+    bCmdTaskPosted = false;
+    ChnMsgTy msg;
+    while (cmdQueue.Pop(msg))
+        HandleCmd(msg);
+}
+
+// Process one command
+void COMChannel::HandleCmd (const ChnMsgTy& msg)
+{
+    inp = msg.in;
+    
+    switch (msg.cmd) {
+        case CHN_CMD_TUNE:
+            // check if this is considered a change, then we start a new stream
+            if (doChange(inp.frequ))
+                StartStreamAsync(false, WORK_TUNE);
+            break;
+            
+        case CHN_CMD_STANDBY:
+            // pre-buffering some other frequency? That's no longer needed
+            if (prev->IsStandbyPrebuf() && prev->GetFrequ() != inp.frequStandby)
+                StopStream(true);
+            break;
+            
+        case CHN_CMD_STOP:
+            gWorkers.Cancel(idx);
+            StopReplay();
+            StopStream(true);
+            StopStream(false);
+            ClearWarmPool();
+            bDesyncJob = false;
+            break;
+            
+        case CHN_CMD_VOLUME:
+            SetVolumeMute();
+            break;
+            
+        case CHN_CMD_REPLAY:
+            Replay();
+            break;
+            
+        case CHN_CMD_AUDIO_DEV:
+            for (WarmStreamTy& w: warmPool)
+                if (w.strm.pMP)
+                    w.strm.pMP->outputDeviceSet(inp.audioDev);
+            for (StreamCtrlTy* pStrm: {&dataA, &dataB}) {
+                if (!pStrm->pMP)
+                    continue;
+                pStrm->pMP->outputDeviceSet(inp.audioDev);
+                // DEBUG: Check what is now reported as device and report both wanted and current
+                if (pStrm == &dataA && dataRefs.GetLogLevel() == logDEBUG) {
+                    char* currDev = libvlc_audio_output_device_get(pStrm->pMP->get());
+                    LOG_MSG(logDEBUG, DBG_VLC_OUT_DEV, idx, inp.audioDev.c_str(), currDev ? currDev : "(null)");
+                    if (currDev)
+                        libvlc_free(currDev);
+                }
+            }
+            break;
+            
+        case CHN_CMD_TICK:
+            Tick();
+            break;
+    }
+    
+    ScheduleDesyncExpiry();
+    UpdateXPAtisFlag();
+    PublishStatus();
+}
+
+/// Only cheap stuff here, everything else is done by jobs in the timer wheel
+void COMChannel::Tick ()
+{
+    // start counting for the switch statistics
+    if (statsStart == std::chrono::time_point<std::chrono::steady_clock>())
+        statsStart = std::chrono::steady_clock::now();
+    
+    // history for "say again", and end of a replay
+    UpdateReplay();
+    if (replayVoice && replayVoice->GetBufferedUs() == 0)
+        StopReplay();
+    
+    // radio effect follows the distance to the station
+    curr->ApplyRadioFx(inp.planePos);
+    prev->ApplyRadioFx(inp.planePos);
+    
+    // follow changes of the desync period, ATIS is never desynced
+    const long desyncBefore = curr->GetDesyncSecs();
+    if (!bStarting && !curr->IsATIS() && curr->RetargetDesync(inp.desyncSecs))
+        LOG_MSG(logDEBUG, DBG_DESYNC_RETARGET, idx+1, curr->streamName.c_str(),
+                desyncBefore, curr->GetDesyncSecs());
+    
+    // idle for a while? Then release resources
+    const std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+    if (curr->IsDefined() || prev->IsDefined() || !warmPool.empty() || IsAsyncRunning()) {
+        tLastBusy = now;
+        bIdleReleased = false;
+    }
+    else if (!bIdleReleased && now - tLastBusy >= std::chrono::seconds(dataRefs.GetIdleReleaseS()))
+        ReleaseIdle();
+}
+
+/// Media players usually go with their streams already,
+/// so what's mostly left are network read buffers.
+void COMChannel::ReleaseIdle ()
+{
+    PublishStatus();
+    const ChnStatusTy before = snapStatus.Read();
+    for (StreamCtrlTy* pStrm: {&dataA, &dataB}) {
+        if (pStrm->pMP)
+            pStrm->ReleasePlayer();
+        pStrm->ReleaseBuffers();
+    }
+    PublishStatus();
+    const ChnStatusTy after = snapStatus.Read();
+    LOG_MSG(logINFO, MSG_CHN_IDLE, idx+1, dataRefs.GetIdleReleaseS(),
+            before.nPlayers, before.bufBytes / 1024,
+            after.nPlayers, after.bufBytes / 1024);
+    bIdleReleased = true;
+}
+
+/// The ring file is created once, when the mixer is active, as only the
+/// mixer sees the decoded audio. `curr` is recorded, also right after
+/// it changed, as this runs every second. What the mixer queued since
+/// is stored here, off the sim thread.
+void COMChannel::UpdateReplay ()
+{
+    if (!pReplay && !bReplayTried && gMixer.IsActive() && dataRefs.GetReplayMin() > 0) {
+        bReplayTried = true;
+        char path[50];
+        snprintf(path, sizeof(path), PATH_REPLAY_FILE, idx+1);
+        pReplay = std::make_unique<ReplayRingTy>();
+        if (!pReplay->Open(dataRefs.GetXPSystemPath() + path, dataRefs.GetReplayMin()))
+            pReplay = nullptr;
+    }
+    curr->SetRecorder(pReplay.get());
+    prev->SetRecorder(nullptr);
+    if (pReplay)
+        pReplay->Store();
+}
+
+/// The transmission is played through a feed and voice of its own,
+/// which ducks the live streams while it plays.
+void COMChannel::Replay ()
+{
+    StopReplay();
+    std::vector<float> samples;
+    std::chrono::time_point<std::chrono::steady_clock> tStart;
+    if (pReplay)
+        pReplay->Store();
+    if (!pReplay || !gMixer.IsActive() || !pReplay->GetLastTx(samples, tStart)) {
+        SHOW_MSG(logINFO, MSG_REPLAY_NONE, idx+1);
+        return;
+    }
+    
+    // the feed holds the entire transmission, as far as the buffer limit allows
+    const AudioFeedPtrTy pFeed =
+    std::make_shared<AudioFeedTy>(long(samples.size() / AUDIO_RATE) + 1, AUDIO_ENC_ULAW,
+                                  size_t(dataRefs.GetAudioBufMaxKB()) * 1024);
+    if (samples.size() > pFeed->GetCapacity())
+        samples.resize(pFeed->GetCapacity());
+    replayVoice = std::make_shared<AudioVoiceTy>(pFeed);
+    replayVoice->SetGain(inp.bMute ? 0.0f : float(inp.volume) / 100.0f);
+    replayVoice->SetDuckOthers(true);
+    gMixer.Add(replayVoice);
+    
+    // due right after the buffers already queued
+    pFeed->Write(samples.data(), unsigned(samples.size()),
+                 libvlc_clock() + int64_t(AUDIO_AL_BUFFERS) * AUDIO_BUF_MS * 1000);
+    SHOW_MSG(logINFO, MSG_REPLAY_START, idx+1, double(samples.size()) / AUDIO_RATE,
+             long(std::chrono::duration_cast<std::chrono::seconds>
+                  (std::chrono::steady_clock::now() - tStart).count()));
+}
+
+// Stop a replay
+void COMChannel::StopReplay ()
+{
+    if (replayVoice)
+        gMixer.Remove(replayVoice);
+    replayVoice = nullptr;
+}
+
+// Called from VLC's event thread, so just post to the executor
+void COMChannel::NotifyPlayerEvent ()
+{
+    PostJob(&COMChannel::PlayerEvent);
+}
+
+// A player changed state, published status is updated by PostJob()
+void COMChannel::PlayerEvent ()
+{
+    RestartFailed();
 }
 
-
-/// Should be called every second, e.g. from a flight loop callback
-/// 1. Checks for frequency change, and if not changed:
-/// 2. Checks distance and then might stop the channel, or switch over to another radio
-void COMChannel::RegularMaintenance ()
+/// The stream's URL is still resolved, so it is just played again
+/// on a fresh media player. A stream that keeps failing is retried
+/// by the regular reach check, but not more often than `CHN_RESTART_MIN_S`.
+void COMChannel::RestartFailed ()
 {
-    // not initialized?
-    if (!IsValid())
-        return;
-    
-    // need to stop previous frequency after curr'ent desync is done?
-    if (prev->IsDefined() && !prev->IsStandbyPrebuf() && curr->IsDesyncDone()) {
-        StopStream(true);
-    }
-    
-    // *** COM frequency change ***
-    // get current frequency and check if this is considered a change
-    if (doChange(dataRefs.GetComFreq(idx))) {
-        // it is: we start a new stream
-        StartStreamAsync(false);
+    if (bStarting || !curr->pMedia || !curr->pMP || !curr->pMP->HasFailed())
         return;
-    }
-    
-    // check for mute status
-    SetVolumeMute();
-    
-    // *** only every 10th call do the expensive stuff ***
-    static int callCnt = 0;
-    if (++callCnt <= 10)
+    const auto now = std::chrono::steady_clock::now();
+    if (tLastFailRestart.time_since_epoch().count() &&
+        now - tLastFailRestart < std::chrono::seconds(CHN_RESTART_MIN_S))
         return;
-    callCnt = 0;
+    tLastFailRestart = now;
     
-    // *** Pre-buffering ***
-    doStandbyPrebuf(dataRefs.GetComStandbyFreq(idx));
+    SHOW_MSG(logWARN, WARN_STREAM_FAILED, idx+1, curr->streamName.c_str());
+    curr->ReleasePlayer();
+    curr->pMP = nullptr;
+    curr->pMedia = nullptr;
+    curr->pFeed = nullptr;
+    PlayStream(*curr, curr->IsATIS() ? 0 : inp.desyncSecs);
+}
+
+/// Finds the closest airport for the active and a pre-buffering stream
+/// and switches over to it, or stops streams out of reach
+void COMChannel::CheckReach ()
+{
+    // a failed stream is restarted
+    RestartFailed();
     
+
     // *** Checks on the active stream ***
     if (curr->IsDefined()) {
         // Find the _currently_ closest airport
-        const LiveATCDataMapTy::iterator apIter = curr->FindClosestAirport();
+        const LiveATCDataMapTy::iterator apIter = curr->FindClosestAirport(inp.planePos);
+        // no other airport to switch to? Then no switch is held back either
+        if (apIter == curr->AirportStreamsEnd() || apIter->first == curr->airportIcao)
+            apSwitchHold[0].clear();
         if (apIter != curr->AirportStreamsEnd() &&
-            apIter->first != curr->airportIcao)
+            apIter->first != curr->airportIcao &&
+            ShallSwitchAirport(*curr, apIter, GetStatus() >= STREAM_BUFFERING))
         {
             // an(other) airport stream is closer, switch to it!
             
@@ -490,18 +1542,19 @@ void COMChannel::RegularMaintenance ()
             }
             
             // copy the new airport's stream
-            curr->CopyFrom(apIter->second);
+            curr->SelectAirport(apIter->second);
+            cntApSwitch++;
+            LogSwitchStats();
 
             // ATIS handling: Only play this newly found stream if it is not ATIS or if LiveATC's ATIS is preferred
             if (dataRefs.PreferLiveATCAtis() || !curr->IsATIS())
-                StartStreamAsync(false);
+                StartStreamAsync(false, WORK_AP_SWITCH);
         }
         // If we are playing then check distance to current station
         else if (GetStatus() >= STREAM_BUFFERING)
         {
-            positionTy posPlane = dataRefs.GetUsersPlanePos();
-            // and stop playing if too far out
-            if (posPlane.dist(curr->airportPos) / M_per_NM > dataRefs.GetMaxRadioDist()) {
+            // and stop playing if out of reach
+            if (!curr->IsInReach(inp.planePos)) {
                 SHOW_MSG(logINFO, MSG_AP_OUT_OF_REACH, idx+1,
                          curr->streamName.c_str());
                 StopStream(false);
@@ -511,9 +1564,13 @@ void COMChannel::RegularMaintenance ()
     
     // *** Checks on the second stream, only if pre-buffering ***
     if (prev->IsStandbyPrebuf()) {
-        const LiveATCDataMapTy::iterator apIter = prev->FindClosestAirport();
+        const LiveATCDataMapTy::iterator apIter = prev->FindClosestAirport(inp.planePos);
+        // no other airport to switch to? Then no switch is held back either
+        if (apIter == prev->AirportStreamsEnd() || apIter->first == prev->airportIcao)
+            apSwitchHold[1].clear();
         if (apIter != prev->AirportStreamsEnd() &&
-            apIter->first != prev->airportIcao)
+            apIter->first != prev->airportIcao &&
+            ShallSwitchAirport(*prev, apIter, false))
         {
             // an(other) airport stream is closer, switch to it!
             
@@ -526,16 +1583,15 @@ void COMChannel::RegularMaintenance ()
             }
             
             // copy the new airport's stream
-            prev->CopyFrom(apIter->second);
+            prev->SelectAirport(apIter->second);
             prev->SetStandbyPrebuf(true);
-            StartStreamAsync(true);
+            StartStreamAsync(true, WORK_STANDBY);
         }
         // If we are buffering then check distance to current station
         else if (prev->GetStatus() >= STREAM_BUFFERING)
         {
-            positionTy posPlane = dataRefs.GetUsersPlanePos();
-            // and stop playing if too far out
-            if (posPlane.dist(prev->airportPos) / M_per_NM > dataRefs.GetMaxRadioDist()) {
+            // and stop playing if out of reach
+            if (!prev->IsInReach(inp.planePos)) {
                 LOG_MSG(logINFO, MSG_AP_STDBY_OUT_OF_REACH, idx+1,
                         prev->streamName.c_str());
                 StopStream(true);
@@ -543,154 +1599,117 @@ void COMChannel::RegularMaintenance ()
         }
 
     }
+    else
+        apSwitchHold[1].clear();
 }
 
-// stop VLC, reset frequency
-void COMChannel::ClearChannel()
+/// Pre-buffering of the stand-by frequency only happens here
+/// if the stand-by frequency is still the one found stable,
+/// typically for retrying once `prev` became available.
+void COMChannel::CheckPrebuf ()
 {
-    // not initialized?
-    if (!IsValid())
-        return;
-
-    // stop output of prev
-    StopStream(true);
-    
-    // (if needed abort startup and) stop output of curr
-    AbortAndWaitForAsync();         // this might block till StartStream aborts
-    StopStream(false);
+    MaintainWarmPool();
+    if (lastFrequStandby && lastFrequStandby == inp.frequStandby)
+        doStandbyPrebuf(lastFrequStandby);
+    PredictNext();
 }
 
-// COM channel's status, mostly depends on `curr->GetStatus()` but takes StartStream() into consideration
-StreamStatusTy COMChannel::GetStatus() const
+/// The stand-by frequency job is restarted with every change of the
+/// stand-by frequency, so when it fires the frequency didn't change
+/// for `CHN_STBY_STABLE_MS`.
+void COMChannel::StandbyStable ()
 {
-    // it actually _is_ the stream's status in all but one cases
-    StreamStatusTy streamStatus = curr->GetStatus();
-    
-    // There are some override cases:
-    
-    // If we are not playing then we might be actively searching:
-    if (streamStatus == STREAM_NOT_PLAYING)
-        return IsAsyncRunning() ? STREAM_SEARCHING : STREAM_NOT_PLAYING;
-
-    return streamStatus;
+    lastFrequStandby = inp.frequStandby;
+    doStandbyPrebuf(lastFrequStandby);
 }
 
-// Textual status summary for end user
-std::string COMChannel::Summary (bool bPrev) const
+/// Stops the previous stream, might keep it warm for a flip back
+void COMChannel::DesyncExpired ()
 {
-    return bPrev ? prev->Summary() : curr->Summary(GetStatus());
+    bDesyncJob = false;
+    if (prev->IsDefined() && !prev->IsStandbyPrebuf() && curr->IsDesyncDone())
+        RetireStream(true);
 }
 
-// Textual status summary for debug purposes
-std::string COMChannel::dbgStatus (bool bPrev) const
+/// Only needed while a previous (not pre-buffering) stream is still around.
+/// Called by the executor after each state change.
+void COMChannel::ScheduleDesyncExpiry ()
 {
-    return bPrev ? prev->dbgStatus() : curr->dbgStatus();
+    if (!jobDesync || !prev->IsDefined() || prev->IsStandbyPrebuf())
+        return;
+    // the voice refines the time point constantly, only move the timer for relevant changes
+    const std::chrono::time_point<std::chrono::steady_clock> done = curr->GetDesyncDone();
+    if (bDesyncJob && std::chrono::abs(done - desyncJobDone) < std::chrono::milliseconds(CHN_DESYNC_RESCHED_MS))
+        return;
+    const long long ms = std::chrono::duration_cast<std::chrono::milliseconds>
+    (done - std::chrono::steady_clock::now()).count();
+    gTimers.Start(jobDesync, int(std::max(ms, 0LL)));
+    desyncJobDone = done;
+    bDesyncJob = true;
 }
 
-//
-// MARK: Static functions
-//
-
-// Initialize *all* VLC instances
-bool COMChannel::InitAllVLC()
+// Post a job's work to the channel's executor
+void COMChannel::PostJob (void (COMChannel::*fn)())
 {
-    // in case of a re-init we firstly stop orderly
-    if (gVLCInst)
-        CleanupAllVLC();
-    
-    // create global VLC instance
-    if (!CreateVLCInstance())
-        return false;
-
-    // fetch all possible output devices
-    UpdateVLCOutputDevices();
-    
-    // create channels
-    for (COMChannel& chn: gChn) {
-        if (!chn.InitVLC())
-            return false;
-    }
-    return true;
+    gWorkers.Post(WORK_CONTROL, idx, [this,fn]{
+        (this->*fn)();
+        ScheduleDesyncExpiry();
+        UpdateXPAtisFlag();
+        PublishStatus();
+    });
 }
 
-// static function: stop still running VLC instances
-/// @warning Blocks! Expected to be called during deactivation/shutdown only.
-void COMChannel::StopAll()
+/// The periodic jobs of all channels are spread evenly over their period
+/// so that the expensive checks don't pile up in the same flight loop call.
+void COMChannel::StartJobs ()
 {
-    for (COMChannel& chn: gChn) {
-        chn.StopStream(true);
-        chn.StopStream(false);
+    if (!jobReach) {
+        jobReach  = gTimers.Add(idx, [this]{ PostJob(&COMChannel::CheckReach); });
+        jobPrebuf = gTimers.Add(idx, [this]{ PostJob(&COMChannel::CheckPrebuf); });
+        jobStby   = gTimers.Add(idx, [this]{ PostJob(&COMChannel::StandbyStable); });
+        jobDesync = gTimers.Add(idx, [this]{ PostJob(&COMChannel::DesyncExpired); });
     }
+    const int n = 2 * std::max(dataRefs.GetComCnt(), 1);
+    gTimers.Start(jobReach,  CHN_REACH_CHECK_MS  * (2*idx+1) / n, CHN_REACH_CHECK_MS);
+    gTimers.Start(jobPrebuf, CHN_PREBUF_CHECK_MS * (2*idx+2) / n, CHN_PREBUF_CHECK_MS);
 }
 
-// Cleanup *all* VLC instances, also stops all playback
-void COMChannel::CleanupAllVLC()
-{
-    // cleanup the channels
-    for (COMChannel& chn: gChn)
-        chn.CleanupVLC();
-    
-    // cleanup the central VLC instance object
-    CleanupVLCInstance();
-}
-
-// Update list of available audio devices
-void COMChannel::UpdateVLCOutputDevices()
+// Remove all jobs from the timer wheel
+void COMChannel::RemoveJobs ()
 {
-    // just use any existing MediaPlayer instance to do so:
-    if (!gChn[0].dataA.pMP)
+    if (!jobReach)
         return;
-    gVLCOutputDevs.clear();
-    gVLCOutputDevs = std::move(gChn[0].dataA.pMP->outputDeviceEnum());
-}
-
-// Set all MediaPlayer to use the given audio device
-void COMChannel::SetAllAudioDevice(const std::string& devId)
-{
-    for (COMChannel& chn : gChn) {
-        if (chn.dataA.pMP) {
-            chn.dataA.pMP->outputDeviceSet(devId);
-            // DEBUG: Check what is now reported as device and report both wanted and current
-            if (dataRefs.GetLogLevel() == logDEBUG) {
-                char* currDev = libvlc_audio_output_device_get(chn.dataA.pMP->get());
-                LOG_MSG(logDEBUG, DBG_VLC_OUT_DEV, chn.idx, devId.c_str(), currDev ? currDev : "(null)");
-                if (currDev)
-                    libvlc_free(currDev);
-            }
-        }
-        if (chn.dataB.pMP)
-            chn.dataB.pMP->outputDeviceSet(devId);
-    }
+    gTimers.RemoveChn(idx);
+    jobReach = jobPrebuf = jobStby = jobDesync = 0;
+    bDesyncJob = false;
 }
 
-
-// Set the volume of all playback streams
-void COMChannel::SetAllVolume(int vol)
+/// X-Plane's ATIS is suppressed while an ATIS stream from LiveATC
+/// is active and LiveATC's ATIS is preferred.
+/// The flight loop then applies this to X-Plane.
+void COMChannel::UpdateXPAtisFlag ()
 {
-    LOG_MSG(logDEBUG, DBG_VLC_VOLUME, vol);
-    for (COMChannel& chn : gChn) {
-        chn.dataA.SetVolume(vol);
-        chn.dataB.SetVolume(vol);
-    }
+    bSuppressXPAtis = dataRefs.PreferLiveATCAtis() && curr->IsATIS();
 }
 
-// (un)Mute all playback streams
-void COMChannel::MuteAll(bool bDoMute)
+/// Determines everything the UI needs, including calls into VLC,
+/// so that readers don't have to
+void COMChannel::PublishStatus ()
 {
-    LOG_MSG(logDEBUG, bDoMute ? DBG_VLC_MUTE : DBG_VLC_UNMUTE);
-    for (COMChannel& chn : gChn) {
-        chn.dataA.SetMute(bDoMute);
-        chn.dataB.SetMute(bDoMute);
+    ChnStatusTy st;
+    st.status = GetStatus();
+    snprintf(st.summary, sizeof(st.summary), "%s", curr->Summary(st.status).c_str());
+    snprintf(st.summaryPrev, sizeof(st.summaryPrev), "%s", prev->Summary().c_str());
+    snprintf(st.streamName, sizeof(st.streamName), "%s", curr->streamName.c_str());
+    snprintf(st.airportIcao, sizeof(st.airportIcao), "%s", curr->airportIcao.c_str());
+    st.desyncDone = curr->GetDesyncDone();
+    st.nPlayers = int(dataA.HasPlayer()) + int(dataB.HasPlayer());
+    st.bufBytes = dataA.GetBufBytes() + dataB.GetBufBytes();
+    for (const WarmStreamTy& w: warmPool) {
+        st.nPlayers += int(w.strm.HasPlayer());
+        st.bufBytes += w.strm.GetBufBytes();
     }
-}
-
-// checks if there is any active stream playing ATIS
-bool COMChannel::AnyATISPlaying()
-{
-    for (const COMChannel& chn : gChn)
-        if (chn.curr->IsATIS())
-            return true;
-    return false;
+    snapStatus.Write(st);
 }
 
 //
@@ -717,7 +1736,7 @@ bool COMChannel::doChange(int _new)
             std::swap(prev, curr);
             SHOW_MSG(logINFO, MSG_COM_IS_NOW_IN, idx+1, curr->GetFrequStr().c_str(),
                      curr->streamName.c_str(),
-                     dataRefs.GetDesyncPeriod());
+                     inp.desyncSecs);
             // pre-buffering is done, we are now active
             curr->SetStandbyPrebuf(false);
             // The -newly- previous stream defines the initial stand-by frequency,
@@ -728,8 +1747,30 @@ bool COMChannel::doChange(int _new)
             return false;
         }
         
-        // move current stream aside
-        TurnCurrToPrev();
+        // Is the new frequency kept warm in the pool?
+        const WarmStreamListTy::iterator warmIter = FindWarm(_new, true);
+        if (warmIter != warmPool.end())
+        {
+            // count hits of predictions
+            if (warmIter->bPredicted) {
+                cntPredictHit++;
+                LogPredictStats();
+            }
+            // move current stream aside, then take over the warm stream
+            TurnCurrToPrev(true);
+            std::swap(*curr, warmIter->strm);
+            EvictWarm(warmIter);        // now just holds the unused stream object
+            // stop the previous stream right away if the warm one is audible already
+            if (curr->IsDesyncDone())
+                RetireStream(true);
+            SHOW_MSG(logINFO, MSG_COM_IS_WARM, idx+1, curr->GetFrequStr().c_str(),
+                     curr->streamName.c_str());
+            SetVolumeMute();
+            return false;
+        }
+        
+        // move current stream aside, keeping a still running `prev` warm
+        TurnCurrToPrev(true);
         // save the new frequency
         curr->SetFrequ(_new);
         return true;
@@ -750,23 +1791,24 @@ bool COMChannel::doChange(int _new)
 /// - It only happens once the standby frequency _changes_ again.
 ///   It won't happen to the previously active frequency only
 ///   because frequencies swapped. The pilot needs to dial a new
-///   standby frequency first.
+///   standby frequency first, and it needs to stay stable for
+///   `CHN_STBY_STABLE_MS` as dialing takes a moment.
 /// - It is not applied to ATIS streams as we play ATIS streams without
 ///   audio desync anyway. They can be played without any further
 ///   delay once they are activated.
-/// - We use the `prev` object for pre-buffering and only if it is available.
+/// - We use the `prev` object for pre-buffering if it is available.
 ///   If `prev` is still busy while switching to a new `curr` stream,
-///   which is desyncing, then we wait. We won't put a third load in parallel
-///   on the LiveATC servers.
+///   which is desyncing, then we try the warm stream pool, whose size
+///   limits the additional load on the LiveATC servers.
 bool COMChannel::doStandbyPrebuf(int _new)
 {
     // One-time init: If the initial stand-by frequency had not been set before
     //                do so now.
     if (!initFrequStandBy)
-        initFrequStandBy = dataRefs.GetComStandbyFreq(idx);
+        initFrequStandBy = inp.frequStandby;
 
     // Don't we need pre-buffering at all according to configuration?
-    if (dataRefs.GetDesyncPeriod() <= 0 ||          // no desync, no need for buffering
+    if (inp.desyncSecs <= 0 ||                      // no desync, no need for buffering
         !dataRefs.ShallPreBufferStandbyFrequ())
         return false;
     
@@ -775,35 +1817,17 @@ bool COMChannel::doStandbyPrebuf(int _new)
     if (_new == initFrequStandBy)
         return false;
     
-    // Dialing a frequency is something that takes a moment as the pilot
-    // really has to "dial" the KHz and the Hz part of the frequency
-    // separately. So we wait for the standby frequency to stay stable
-    // between two calls (usually 10s apart) before we take action.
-    
-    // Is _new different from the last we saw 10s ago?
-    if (_new != lastFrequStandby) {
-        // Then let's remember what we see now
-        lastFrequStandby = _new;
-        
-        // In case we are pre-buffering already right now we can, however,
-        // stop that pre-buffering already.
-        if (prev->IsDefined() && prev->IsStandbyPrebuf())
-            StopStream(true);
-        
-        // but don't start anything now...standby frequency is still being changed
-        return false;
-        
-    }
-    
-    // The stand-by frequency is different from initial and stayed the same for 10s.
-    
-    // Is prev already pre-buffering our frequency?
-    if (prev->IsStandbyPrebuf() && prev->GetFrequ() == _new)
+    // Is prev already pre-buffering our frequency? Or is it kept warm?
+    if ((prev->IsStandbyPrebuf() && prev->GetFrequ() == _new) ||
+        FindWarm(_new, false) != warmPool.end())
         return false;
     
     // Is prev not available for us because it's busy with something else?
-    if (prev->IsDefined() && !prev->IsStandbyPrebuf())
+    // Then try warming up the frequency in the pool
+    if (prev->IsDefined() && !prev->IsStandbyPrebuf()) {
+        WarmUp(_new, WARM_LIKELY_STANDBY);
         return false;
+    }
     
     // But there's another async startup running right now?
     // That must have priority
@@ -818,19 +1842,94 @@ bool COMChannel::doStandbyPrebuf(int _new)
     // Start the pre-buffering
     prev->SetFrequ(_new);
     prev->SetStandbyPrebuf(true);
-    StartStreamAsync(true);
+    StartStreamAsync(true, WORK_STANDBY);
     return true;
 }
 
+/// Switching airports is expensive: The current stream is phased out,
+/// a new VLC media is created, a new network stream opened, and the
+/// full audio desync period has to pass before anything is audible.
+/// If two airports are about equally far away the closest one can
+/// change with every check, so we only switch if
+/// - the current airport is out of reach (always switch), or
+/// - the current airport has been selected for at least `AP_SWITCH_MIN_DWELL_S`, and
+/// - the new airport is closer by the hysteresis margin
+///   (`AP_SWITCH_HYST_NM` _and_ `AP_SWITCH_HYST_REL`), and
+/// - for audible streams, the distance gained outweighs the audio lost
+///   by the restart, which is `AP_SWITCH_RESTART_S` plus the desync period.
+bool COMChannel::ShallSwitchAirport (const StreamCtrlTy& strm,
+                                     const LiveATCDataMapTy::iterator& apIter,
+                                     bool bAudible)
+{
+    std::string& hold = apSwitchHold[&strm == curr ? 0 : 1];
+
+    // nothing selected yet or position unknown? Then there's nothing to lose
+    if (strm.airportIcao.empty() || std::isnan(strm.airportPos.lat())) {
+        hold.clear();
+        return true;
+    }
+    
+    const positionTy& posPlane = inp.planePos;
+    double currDist_nm = NAN;
+    const double newDist_nm  = posPlane.dist(apIter->second.airportPos) / M_per_NM;
+    
+    // current airport is out of reach? Then we switch no matter what
+    if (!strm.IsInReach(posPlane, &currDist_nm)) {
+        hold.clear();
+        return true;
+    }
+    
+    // check the policy, first failing check is the reason to stay
+    const double gain_nm = currDist_nm - newDist_nm;
+    const char* reason = nullptr;
+    if (strm.GetSecSinceAirportSelected() < AP_SWITCH_MIN_DWELL_S)
+        reason = "minimum dwell time";
+    else if (gain_nm < AP_SWITCH_HYST_NM ||
+             gain_nm < currDist_nm * AP_SWITCH_HYST_REL)
+        reason = "hysteresis";
+    else if (bAudible &&
+             gain_nm < (AP_SWITCH_RESTART_S + inp.desyncSecs) * AP_SWITCH_NM_PER_S)
+        reason = "restart cost";
+    
+    if (!reason) {
+        hold.clear();
+        return true;
+    }
+    
+    // we stay, count each new hold, log whenever candidate or reason change
+    const std::string newHold = apIter->first + ':' + reason;
+    if (hold != newHold) {
+        if (hold.compare(0, apIter->first.size() + 1, apIter->first + ':') != 0)
+            cntApSwitchHold++;
+        hold = newHold;
+        LOG_MSG(logDEBUG, DBG_AP_SWITCH_HOLD, idx+1,
+                strm.airportIcao.c_str(), currDist_nm,
+                apIter->first.c_str(), newDist_nm, reason);
+    }
+    return false;
+}
+
 // VLC play control
 
-void COMChannel::StartStreamAsync (bool bStandby)
+void COMChannel::StartStreamAsync (bool bStandby, WorkPrioTy prio)
 {
-    // Don't want to run multiple threads in parallel...this might block!
-    AbortAndWaitForAsync();
-    // Start the stream asynchronously
-    futVlcStart = std::async(std::launch::async,
-                             &COMChannel::StartStream, this, bStandby);
+    // queued startups of less or same importance are dropped,
+    // that includes warm-ups, which then must give up their pool entry
+    if (gWorkers.Cancel(idx, prio) > 0) {
+        for (WarmStreamListTy::iterator iter = warmPool.begin();
+             iter != warmPool.end();)
+        {
+            if (iter->bStartQueued)
+                EvictWarm(iter++);
+            else
+                ++iter;
+        }
+    }
+    // Start the stream asynchronously, will wait for a running task of this channel
+    gWorkers.Post(prio, idx, [this,bStandby,prio]{
+        prioStart = prio;
+        StartStream(bStandby);
+    });
 }
 
 /// Starts the `curr` streams. Expects `curr.frequ` to be properly set.
@@ -840,7 +1939,7 @@ void COMChannel::StartStreamAsync (bool bStandby)
 void COMChannel::StartStream (bool bStandby)
 {
     // start it only once...it could take a moment
-    if (flagStartingStream.test_and_set())
+    if (bStarting.exchange(true))
         return;     // return immediately if startup in progress
     
     // other threads can set this flag to have StartSteam abort early
@@ -850,7 +1949,7 @@ void COMChannel::StartStream (bool bStandby)
     StreamCtrlTy& strm = bStandby ? *prev : *curr;
 
     // For how long shall audio desync last?
-    long desyncSecs = dataRefs.GetDesyncPeriod();
+    long desyncSecs = inp.desyncSecs;
     
     // handling of secondary stream only if we start curr
     if (!bStandby)
@@ -870,9 +1969,9 @@ void COMChannel::StartStream (bool bStandby)
         // once we queried LiveATC. That can take 1 or 2 seconds or even longer.
         // During this delay XP might already start chattering its own ATIS.
         // We stop that here and re-enable later if the channel happened not to be
-        // an ATIS channel.
+        // an ATIS channel. (The flight loop applies this flag to X-Plane.)
         if (dataRefs.PreferLiveATCAtis())
-            dataRefs.EnableXPsATIS(false);
+            bSuppressXPAtis = true;
     }
     else
     {
@@ -881,46 +1980,9 @@ void COMChannel::StartStream (bool bStandby)
             bAbortStart = true;
     }
 
-    // playUrl might have been filled by RegularMaintenance
-    // when an airport came in reach
-    if (!bAbortStart && strm.playUrl.empty()) {
-        // find a new URL of a stream to play -> playUrl
-        if (!strm.FetchUrlForFrequ())
-            bAbortStart = true;
-    }
-    
-    // strm is now updated and contains the to-be stream
-    
-    // in most cases the initial URL points to a .pls file,
-    // which is a simple playlist format.
-    // To avoid running LUA scripts for parsing HTTP responses in the VLC instance
-    // (which is difficult to control from another application not
-    //  running right within the VLC folder)
-    // we quickly parse the .pls format ourselves and extract the actual URL
-    
-    // Example for https://www.liveatc.net/play/kjfk_gnd.pls :
-    //      [playlist]
-    //      File1=http://d.liveatc.net/kjfk_gnd
-    //      Title1=KJFK Ground
-    //      Length1=-1
-    
-    if (!bAbortStart && endsWith(strm.playUrl, LIVE_ATC_PLS)) {
-        std::string playlist;
-        if (HttpGet(strm.playUrl, playlist))
-        {
-            static std::regex rePlsFile1 ( R"#(File1=(http\S+))#" );
-            std::smatch m;
-            if (!std::regex_search(playlist, m, rePlsFile1))
-            { LOG_MSG(logWARN, WARN_RE_ICAO, "File1"); }
-            else strm.playUrl = { m[1].str() };
-        }
-        else
-        {
-            // HTTP went wrong, clear this channel for now so we don't try again without the user doing someting
-            strm.StopAndClear();
-            bAbortStart = true;
-        }
-    }
+    // find the stream to play, strm is then updated and contains the to-be stream
+    if (!bAbortStart && !ResolveStreamUrl(strm))
+        bAbortStart = true;
     
     // *** ATIS handling ***
     if (!bAbortStart && strm.IsATIS())
@@ -937,10 +1999,10 @@ void COMChannel::StartStream (bool bStandby)
             StopStream(true);           // latest now kill pushed-aside previous stream
             if (dataRefs.PreferLiveATCAtis()) {
                 // we will play LiveATC, so suppress X-Plane's internal ATIS
-                dataRefs.EnableXPsATIS(false);
+                bSuppressXPAtis = true;
             } else {
                 // X-Plane's ATIS preferred! So we do not play LiveATC's stream
-                dataRefs.EnableXPsATIS(true);
+                bSuppressXPAtis = false;
                 LOG_MSG(logINFO, MSG_COM_IS_NOW_IN, idx+1, strm.GetFrequStr().c_str(),
                         strm.streamName.c_str());
                 // return
@@ -961,7 +2023,10 @@ void COMChannel::StartStream (bool bStandby)
             // something else:
             initFrequStandBy = strm.GetFrequ();
         }
-        flagStartingStream.clear();
+        ScheduleDesyncExpiry();
+        UpdateXPAtisFlag();
+        bStarting = false;
+        PublishStatus();
         return;
     }
     
@@ -982,32 +2047,109 @@ void COMChannel::StartStream (bool bStandby)
     }
     
     // Create and play the media
-    strm.pMedia = std::make_unique<VLC::Media>(*gVLCInst,
+    if (PlayStream(strm, desyncSecs))
+        SetVolumeMute();
+    
+    // done starting this stream
+    ScheduleDesyncExpiry();
+    UpdateXPAtisFlag();
+    bStarting = false;
+    PublishStatus();
+}
+
+/// - `playUrl` might have been filled already when an airport came in reach,
+///   otherwise LiveATC is queried for the frequency.
+/// - In most cases the URL then points to a .pls file, which is a simple
+///   playlist format. To avoid running LUA scripts for parsing HTTP responses
+///   in the VLC instance (which is difficult to control from another
+///   application not running right within the VLC folder) we quickly
+///   parse the .pls format ourselves and extract the actual URL.
+///
+/// Example for https://www.liveatc.net/play/kjfk_gnd.pls :
+///
+///     [playlist]
+///     File1=http://d.liveatc.net/kjfk_gnd
+///     Title1=KJFK Ground
+///     Length1=-1
+bool COMChannel::ResolveStreamUrl (StreamCtrlTy& strm)
+{
+    // find a new URL of a stream to play -> playUrl
+    if (strm.playUrl.empty() && !strm.FetchUrlForFrequ(inp.planePos))
+        return false;
+    
+    if (endsWith(strm.playUrl, LIVE_ATC_PLS)) {
+        std::string url;
+        if (!gPrefetch.ResolvePls(strm.playUrl, url)) {
+            // HTTP went wrong, clear this stream for now so we don't try again without the user doing someting
+            strm.StopAndClear();
+            return false;
+        }
+        if (!url.empty())
+            strm.playUrl = std::move(url);
+    }
+    return true;
+}
+
+/// If another stream plays the same feed through the mixer already
+/// then we just add a voice to its feed, no new connection, no new decoder.
+/// Otherwise create the media and start playback.
+bool COMChannel::PlayStream (StreamCtrlTy& strm, long desyncSecs)
+{
+    // listen in on a player already playing the feed?
+    if (gMixer.IsActive() && !strm.pMedia) {
+        StreamShareTy::SharedTy sh = gShares.Join(strm.playUrl);
+        if (sh.pMP) {
+            if (strm.pMP)                   // don't need our own idle player
+                strm.ReleasePlayer();
+            strm.pMP    = std::move(sh.pMP);
+            strm.pMedia = std::move(sh.pMedia);
+            strm.pFeed  = std::move(sh.pFeed);
+            strm.pMP->Notify(this);
+            strm.AttachVoice(desyncSecs);
+            if (desyncSecs > 0)
+                strm.SetAudioDesync(desyncSecs);
+            LOG_MSG(logDEBUG, DBG_STREAM_SHARED, idx+1,
+                    strm.streamName.c_str(), strm.playUrl.c_str());
+            return true;
+        }
+    }
+    
+    // media player is created only now that it is needed,
+    // its audio goes to the mixer (if active)
+    if (!strm.EnsurePlayer())
+        return false;
+    strm.pMP->Notify(this);
+    strm.AttachVoice(desyncSecs);
+    strm.pMedia = std::make_shared<VLC::Media>(*gVLCInst,
                                                strm.playUrl,
                                                VLC::Media::FromLocation);
     strm.pMP->setMedia(*strm.pMedia);
+    cntRestart++;
     if (!strm.pMP->play()) {
         // playback failed
         strm.ClearDesyncTimer();
         SHOW_MSG(logERR, ERR_VLC_PLAY, strm.playUrl.c_str(), vlcErrMsg().c_str());
-    } else {
-        // playback started successfully
-        if (desyncSecs > 0) {
-            // set audio desync if requested and the desync timer
-            strm.SetAudioDesync(desyncSecs);
-        }
-
-        // set audio device and volume
-        strm.pMP->outputDeviceSet(dataRefs.GetAudioDev());
-        SetVolumeMute();
+        return false;
     }
     
-    // done starting this stream
-    flagStartingStream.clear();
+    // playback started successfully
+    if (desyncSecs > 0) {
+        // set audio desync if requested and the desync timer
+        strm.SetAudioDesync(desyncSecs);
+    }
+    
+    // set audio device
+    strm.pMP->outputDeviceSet(inp.audioDev);
+    
+    // offer it to others wanting to play the same feed
+    if (strm.pFeed)
+        gShares.Publish(strm.playUrl, {strm.pMP, strm.pMedia, strm.pFeed});
+    return true;
 }
 
 void COMChannel::StopStream (bool bPrev)
 {
+    StopTimerTy stopTimer;
     StreamCtrlTy& atcData = bPrev ? *prev : *curr;
     
     // stop that stream
@@ -1025,43 +2167,53 @@ void COMChannel::StopStream (bool bPrev)
 void COMChannel::SetVolumeMute ()
 {
     // globally muted? Or this channel muted?
-    if (dataRefs.IsMuted() || dataRefs.ShallMuteCom(idx)) {
+    if (inp.bMute) {
         curr->SetMute(true);
         prev->SetMute(true);
     } else {
-        curr->SetVolume(dataRefs.GetVolume(), true);
+        curr->SetVolume(inp.volume, true);
         if (prev->IsStandbyPrebuf())
             prev->SetMute(true);
         else
-            prev->SetVolume(dataRefs.GetVolume(), true);
+            prev->SetVolume(inp.volume, true);
     }
+    
+    // the COM selected for transmit ducks the others while receiving
+    curr->SetDuckOthers(inp.bTx && !inp.bMute);
+    prev->SetDuckOthers(inp.bTx && !inp.bMute && !prev->IsStandbyPrebuf());
 }
 
-// Checks if an async StartStream() operation is in progress
+// Checks if an async StartStream() operation is queued or in progress
 bool COMChannel::IsAsyncRunning () const
 {
-    return futVlcStart.valid() &&
-    futVlcStart.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    // command processing doesn't count, only startups
+    return gWorkers.IsBusy(idx, WORK_TUNE);
 }
 
 // Wait for StartStream() to complete
 void COMChannel::AbortAndWaitForAsync()
 {
-    if (futVlcStart.valid()) {
+    gWorkers.Cancel(idx, WORK_CONTROL);
+    if (bStarting)
         bAbortStart = true;         // let StartStream() abort as soon as possible
-        futVlcStart.get();
-    }
+    gWorkers.WaitIdle(idx);
 }
 
 /// If `prev` is still active it is stopped first, which would block
-void COMChannel::TurnCurrToPrev()
+void COMChannel::TurnCurrToPrev (bool bKeepWarm)
 {
-    // if there's still a previous stream running kill it
-    if (prev->IsDefined())
-        StopStream(true);
+    // if there's still a previous stream running kill it,
+    // or keep it warm, more so if it is the dialed stand-by frequency
+    if (prev->IsDefined()) {
+        if (bKeepWarm)
+            RetireStream(true, prev->IsStandbyPrebuf() ? WARM_LIKELY_STANDBY : 0.0);
+        else
+            StopStream(true);
+    }
     
     // now swap curr<->prev, so that curr then is an initialized fresh object
     std::swap(curr, prev);
+    prev->SetRecorder(nullptr);
     
     // The -newly- previous stream defines the initial stand-by frequency,
     // which we are _not_ to pre-buffer. We just stopped listening to it!
@@ -1072,7 +2224,244 @@ void COMChannel::TurnCurrToPrev()
     //  set anything now then it might be stopped early by
     //  RegularMainteanance(), which runs in main thread)
     // save time when audio desync should be finished
-    long desyncSecs = dataRefs.GetDesyncPeriod();
-    if (desyncSecs > 0)
-        curr->SetAudioDesync(desyncSecs);
+    if (inp.desyncSecs > 0)
+        curr->SetAudioDesync(inp.desyncSecs);
+}
+
+//
+// MARK: Warm stream pool
+//
+
+/// Streams are kept warm only if they are worth it:
+/// - they are actually running,
+/// - they are no ATIS streams (ATIS plays without desync anyway),
+/// - audio desync is configured (otherwise there's little to gain),
+/// - and there is room in the pool, which is shared by all channels.
+///   Streams with a lower score are evicted for the new one.
+bool COMChannel::RetireStream (bool bPrev, double likelihood)
+{
+    StreamCtrlTy& strm = bPrev ? *prev : *curr;
+    
+    // worth keeping? (A `prev` on `curr`'s frequency is an airport switch's leftover)
+    if (!gVLCInst || inp.desyncSecs <= 0 ||
+        strm.GetStatus() < STREAM_BUFFERING || strm.IsATIS() ||
+        (bPrev && strm.GetFrequ() == curr->GetFrequ()))
+    {
+        StopStream(bPrev);
+        return false;
+    }
+    
+    // an older warm stream on the same frequency is outdated now
+    const WarmStreamListTy::iterator oldIter = FindWarm(strm.GetFrequ(), false);
+    if (oldIter != warmPool.end())
+        EvictWarm(oldIter);
+    
+    // is there room in the pool?
+    if (!ReserveWarm(WarmStreamTy::Score(likelihood, 0))) {
+        StopStream(bPrev);
+        return false;
+    }
+    
+    // move the stream into the pool, muted
+    warmPool.emplace_back();
+    WarmStreamTy& w = warmPool.back();
+    w.id = nextWarmId++;
+    w.likelihood = likelihood;
+    w.created = w.lastUsed = std::chrono::steady_clock::now();
+    std::swap(w.strm, strm);
+    w.strm.SetStandbyPrebuf(false);
+    w.strm.SetMute(true);
+    cntWarm++;
+    LOG_MSG(logDEBUG, DBG_WARM_KEEP, idx+1,
+            w.strm.streamName.c_str(), w.strm.GetFrequStr().c_str());
+    
+    // the vacated stream object gets a media player of its own once needed again
+    strm.ClearDesyncTimer();
+    return true;
+}
+
+/// Creates the pool entry right away,
+/// the actual stream lookup and startup is done by a low-priority task.
+bool COMChannel::WarmUp (int frequ, double likelihood, bool bPredicted)
+{
+    if (!gVLCInst || !frequ || inp.desyncSecs <= 0 ||
+        frequ == curr->GetFrequ() || frequ == prev->GetFrequ())
+        return false;
+    
+    // already warm? Then just remember it's still wanted
+    const WarmStreamListTy::iterator iter = FindWarm(frequ, false);
+    if (iter != warmPool.end()) {
+        iter->likelihood = std::max(iter->likelihood, likelihood);
+        iter->lastUsed = std::chrono::steady_clock::now();
+        return false;
+    }
+    
+    // is there room in the pool?
+    if (!ReserveWarm(WarmStreamTy::Score(likelihood, 0)))
+        return false;
+    
+    warmPool.emplace_back();
+    WarmStreamTy& w = warmPool.back();
+    w.id = nextWarmId++;
+    w.likelihood = likelihood;
+    w.bPredicted = bPredicted;
+    w.created = w.lastUsed = std::chrono::steady_clock::now();
+    w.strm.SetFrequ(frequ);
+    w.strm.SetMute(true);           // media player is created once the stream starts
+    w.bStartQueued = true;
+    cntWarm++;
+    
+    // the startup can take a while, it's done by a task
+    const unsigned long id = w.id;
+    gWorkers.Post(WORK_PREFETCH, idx, [this,id]{ StartWarmStream(id); });
+    return true;
+}
+
+/// The candidates are the current airport's streams as prefetched,
+/// see FeedPrefetchTy::CheckAirports(). Only the most likely frequency
+/// is warmed up to save bandwidth. The stand-by frequency is left to
+/// doStandbyPrebuf().
+void COMChannel::PredictNext ()
+{
+    if (!dataRefs.ShallPredictNextFrequ() || curr->airportIcao.empty() ||
+        curr->GetStatus() < STREAM_BUFFERING)
+        return;
+    
+    // all streams of the current airport
+    std::vector<std::pair<int,LiveATCDataTy>> vFeeds;
+    if (!gPrefetch.LookupAirport(curr->airportIcao, vFeeds))
+        return;
+    
+    // find a stream of the most likely next facility
+    for (const FacilityLikelihoodTy& fl: PredictNextFacilities(inp.phase, GetFacilities(curr->streamName)))
+    {
+        for (const std::pair<int,LiveATCDataTy>& feed: vFeeds) {
+            if (!(GetFacilities(feed.second.streamName) & fl.first) ||
+                feed.first == curr->GetFrequ() ||
+                feed.first == inp.frequStandby)
+                continue;
+            // warm it up (or keep it warm if already)
+            if (WarmUp(feed.first, fl.second, true)) {
+                cntPredict++;
+                LOG_MSG(logDEBUG, DBG_PREDICT_NEXT, idx+1,
+                        feed.first / 1000, feed.first % 1000,
+                        feed.second.streamName.c_str(), fl.second * 100.0,
+                        GetPhaseStr(inp.phase));
+            }
+            return;
+        }
+    }
+}
+
+// Task: Start the warm stream with the given id
+void COMChannel::StartWarmStream (unsigned long id)
+{
+    // the entry might have been evicted in the meantime
+    const WarmStreamListTy::iterator iter =
+    std::find_if(warmPool.begin(), warmPool.end(),
+                 [id](const WarmStreamTy& w){ return w.id == id; });
+    if (iter == warmPool.end())
+        return;
+    iter->bStartQueued = false;
+    
+    // find the stream, we don't keep ATIS warm
+    StreamCtrlTy& strm = iter->strm;
+    if (!ResolveStreamUrl(strm) || strm.IsATIS()) {
+        EvictWarm(iter);
+        return;
+    }
+    
+    // start it muted
+    LOG_MSG(logDEBUG, DBG_WARM_START, idx+1, strm.dbgStatus().c_str());
+    if (!PlayStream(strm, inp.desyncSecs))
+        EvictWarm(iter);
+    else
+        strm.SetMute(true);
+}
+
+/// For a handover the stream must be running and still in reach.
+/// Among several candidates the one done with audio desync is preferred
+/// as only then the pilot hears audio immediately.
+WarmStreamListTy::iterator COMChannel::FindWarm (int frequ, bool bForHandover)
+{
+    WarmStreamListTy::iterator best = warmPool.end();
+    for (WarmStreamListTy::iterator iter = warmPool.begin();
+         iter != warmPool.end();
+         ++iter)
+    {
+        const StreamCtrlTy& strm = iter->strm;
+        if (strm.GetFrequ() != frequ)
+            continue;
+        if (!bForHandover)
+            return iter;
+        if (strm.GetStatus() < STREAM_BUFFERING || !strm.IsInReach(inp.planePos))
+            continue;
+        if (best == warmPool.end() ||
+            (strm.IsDesyncDone() && !best->strm.IsDesyncDone()))
+            best = iter;
+    }
+    return best;
+}
+
+/// The budget is shared by all channels, but a channel only ever evicts
+/// its own warm streams. (Other channels' streams are owned by their executors.)
+bool COMChannel::ReserveWarm (double score)
+{
+    const int maxWarm = dataRefs.GetWarmPoolSize();
+    for (;;) {
+        // try to reserve one slot of the budget
+        int n = cntWarmAll;
+        while (n < maxWarm)
+            if (cntWarmAll.compare_exchange_weak(n, n+1))
+                return true;
+        
+        // no room: evict our lowest-scored stream if it scores lower than the newcomer
+        const WarmStreamListTy::iterator lowest =
+        std::min_element(warmPool.begin(), warmPool.end(),
+                         [](const WarmStreamTy& a, const WarmStreamTy& b)
+                         { return a.Score() < b.Score(); });
+        if (lowest == warmPool.end() || lowest->Score() >= score)
+            return false;
+        EvictWarm(lowest);
+    }
+}
+
+// Stop and remove a warm stream
+void COMChannel::EvictWarm (WarmStreamListTy::iterator it)
+{
+    if (it->strm.GetStatus() >= STREAM_BUFFERING) {
+        LOG_MSG(logDEBUG, DBG_WARM_EVICT, idx+1,
+                it->strm.streamName.c_str(), it->strm.GetFrequStr().c_str());
+    }
+    if (it->strm.pMP)
+        it->strm.StopAndClear();
+    if (it->bPredicted)
+        predictSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - it->created).count();
+    warmPool.erase(it);
+    cntWarm--;
+    cntWarmAll--;
+}
+
+// Stop warm streams out of reach or unused for too long
+void COMChannel::MaintainWarmPool ()
+{
+    for (WarmStreamListTy::iterator iter = warmPool.begin();
+         iter != warmPool.end();)
+    {
+        const WarmStreamTy& w = *iter;
+        const int ageS = w.GetSecSinceUsed();
+        if (ageS > WARM_MAX_AGE_S ||
+            (ageS > WARM_START_TIMEOUT_S && w.strm.GetStatus() < STREAM_BUFFERING) ||
+            (!w.strm.airportIcao.empty() && !w.strm.IsInReach(inp.planePos)))
+            EvictWarm(iter++);
+        else
+            ++iter;
+    }
+}
+
+// Stop all warm streams
+void COMChannel::ClearWarmPool ()
+{
+    while (!warmPool.empty())
+        EvictWarm(warmPool.begin());
 }
@@ -0,0 +1,221 @@
+//
+//  PLALineOfSight.cpp
+//  PlayLiveATC
+//
+// Terrain line-of-sight checks between plane and airport stations,
+// performed incrementally in small per-frame time slices
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only line-of-sight checker
+LOSCheckerTy gLOS;
+
+//
+// MARK: LOSCheckerTy
+//
+
+LOSCheckerTy::~LOSCheckerTy()
+{
+    if (probeRef)
+        XPLMDestroyProbe(probeRef);
+    probeRef = nullptr;
+}
+
+// Return the (cached) line-of-sight from plane to station, queue a check if unknown
+LOSResultTy LOSCheckerTy::Query (const std::string& icao,
+                                 const positionTy& planePos,
+                                 const positionTy& stationPos)
+{
+    // without proper positions we can't tell
+    if (std::isnan(planePos.lat()) || std::isnan(planePos.alt_m()) ||
+        std::isnan(stationPos.lat()) || std::isnan(stationPos.alt_m()))
+        return LOS_UNKNOWN;
+    
+    std::lock_guard<std::mutex> lock(mtx);
+    
+    // cached result available?
+    CellKeyTy key = MakeKey(icao, planePos);
+    auto iter = mapCache.find(key);
+    if (iter != mapCache.end())
+        return iter->second;
+    
+    // already queued or being probed?
+    if (bWorking && !(workKey < key) && !(key < workKey))
+        return LOS_UNKNOWN;
+    for (const JobTy& job: jobs)
+        if (!(job.key < key) && !(key < job.key))
+            return LOS_UNKNOWN;
+    
+    // queue a new check from the plane's antenna to the station's antenna
+    JobTy job;
+    job.key = std::move(key);
+    job.from = planePos;
+    job.from.alt_m() += RADIO_ANT_PLANE_M;
+    job.to = stationPos;
+    job.to.alt_m() += RADIO_ANT_STATION_M;
+    job.vec = job.from.between(job.to);
+    job.nSamples = std::clamp(int(job.vec.dist / LOS_SAMPLE_DIST_M), 1, LOS_MAX_SAMPLES);
+    jobs.emplace_back(std::move(job));
+    return LOS_UNKNOWN;
+}
+
+/// The job is taken out of the queue while being probed,
+/// so that queries from other threads don't wait for the probes.
+bool LOSCheckerTy::DoWork (std::chrono::microseconds budget)
+{
+    using namespace std::chrono;
+    const steady_clock::time_point tStart = steady_clock::now();
+    steady_clock::time_point tNow = tStart;
+    while (tNow - tStart < budget)
+    {
+        JobTy job;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (jobs.empty())
+                return false;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            workKey = job.key;
+            bWorking = true;
+        }
+        const steady_clock::time_point tJobStart = tNow;
+        job.nFrames++;
+        
+        // probe sample by sample till budget is used up or we have a result
+        LOSResultTy res = LOS_UNKNOWN;
+        while (res == LOS_UNKNOWN && tNow - tStart < budget) {
+            res = ProbeNextSample(job);
+            tNow = steady_clock::now();
+        }
+        
+        // keep track of time spent
+        const microseconds tSlice = duration_cast<microseconds>(tNow - tJobStart);
+        job.tTotal += tSlice;
+        if (tSlice > job.tMaxSlice)
+            job.tMaxSlice = tSlice;
+        
+        std::lock_guard<std::mutex> lock(mtx);
+        bWorking = false;
+        
+        // not done yet? Then we continue next frame
+        if (res == LOS_UNKNOWN) {
+            jobs.emplace_front(std::move(job));
+            break;
+        }
+        
+        // done: store result
+        LOG_MSG(logDEBUG, DBG_LOS_DONE, job.key.icao.c_str(),
+                res == LOS_BLOCKED ? "blocked" : "clear",
+                job.nextSample, job.nFrames,
+                (long long)job.tTotal.count(), (long long)job.tMaxSlice.count());
+        if (mapCache.size() >= LOS_CACHE_MAX)
+            mapCache.clear();
+        mapCache.emplace(std::move(job.key), res);
+    }
+    
+    std::lock_guard<std::mutex> lock(mtx);
+    return !jobs.empty();
+}
+
+// Any checks pending?
+bool LOSCheckerTy::HasWork () const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return !jobs.empty();
+}
+
+// Removes all cached results and pending jobs
+void LOSCheckerTy::Clear ()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    mapCache.clear();
+    jobs.clear();
+    bWorking = false;
+    if (probeRef)
+        XPLMDestroyProbe(probeRef);
+    probeRef = nullptr;
+}
+
+// Compute the plane's cache cell
+LOSCheckerTy::CellKeyTy LOSCheckerTy::MakeKey (const std::string& icao,
+                                               const positionTy& planePos)
+{
+    CellKeyTy key;
+    key.latIdx = int(std::floor(planePos.lat() / LOS_GRID_DEG));
+    key.lonIdx = int(std::floor(planePos.lon() / LOS_GRID_DEG));
+    key.altIdx = int(std::floor(planePos.alt_m() / LOS_GRID_ALT_M));
+    key.icao = icao;
+    return key;
+}
+
+/// The direct line between both antennas is compared to the terrain
+/// at each sample point. The earth's curvature (with the effective
+/// radius for VHF propagation) lifts the terrain in the middle of the
+/// path by `d1 * d2 / (2 * k * R)` relative to that line.
+/// Samples, which cannot be probed (scenery not loaded), don't block.
+LOSResultTy LOSCheckerTy::ProbeNextSample (JobTy& job)
+{
+    // all samples passed? Then the line of sight is clear
+    if (job.nextSample >= job.nSamples)
+        return LOS_CLEAR;
+    
+    const double f = double(job.nextSample++) / double(job.nSamples);
+    const positionTy pos = job.from.destPos(vectorTy(job.vec.angle, job.vec.dist * f));
+    const double terrain_m = YProbe_at_m(pos, probeRef, false);
+    if (std::isnan(terrain_m))
+        return LOS_UNKNOWN;
+    
+    const double line_m  = job.from.alt_m() + (job.to.alt_m() - job.from.alt_m()) * f;
+    const double bulge_m = (job.vec.dist * f) * (job.vec.dist * (1.0 - f)) / (RADIO_K_FACTOR * EARTH_D_M);
+    return terrain_m + bulge_m > line_m ? LOS_BLOCKED : LOS_UNKNOWN;
+}
+
+//
+// MARK: Flight loop callback
+//
+
+/// Called every frame while there are checks pending, otherwise every second
+float LOSFlightLoopCB (float, float, int, void*)
+{
+    return gLOS.DoWork(LOS_FRAME_BUDGET) ? -1.0f : 1.0f;
+}
+
+// Start the per-frame flight loop callback working on line-of-sight checks
+void LOSStart ()
+{
+    XPLMRegisterFlightLoopCallback(LOSFlightLoopCB, 1.0f, NULL);
+}
+
+// Stop the flight loop callback and clear all results
+void LOSStop ()
+{
+    XPLMUnregisterFlightLoopCallback(LOSFlightLoopCB, NULL);
+    gLOS.Clear();
+}
@@ -0,0 +1,181 @@
+//
+//  PLAPredict.cpp
+//  PlayLiveATC
+//
+// Flight phase detection and prediction of the next facility to be tuned
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only flight phase detector
+FlightPhaseDetectorTy gPhase;
+
+// Flight phase as text
+const char* GetPhaseStr (FlightPhaseTy phase)
+{
+    switch (phase) {
+        case PHASE_UNKNOWN:     return "unknown";
+        case PHASE_PARKED:      return "parked";
+        case PHASE_TAXI_OUT:    return "taxi out";
+        case PHASE_TAKEOFF:     return "takeoff";
+        case PHASE_CLIMB:       return "climb";
+        case PHASE_CRUISE:      return "cruise";
+        case PHASE_DESCENT:     return "descent";
+        case PHASE_APPROACH:    return "approach";
+        case PHASE_LANDING:     return "landing";
+        case PHASE_TAXI_IN:     return "taxi in";
+        default:                return "?";     // must not happen
+    }
+}
+
+//
+// MARK: Facilities
+//
+
+/// LiveATC's stream names are free text like "KSFO Gnd/Twr" or
+/// "EDDF Approach (Arrival)", so we look for typical keywords and abbreviations
+unsigned GetFacilities (const std::string& streamName)
+{
+    static const std::pair<std::regex,FacilityTy> RE_FAC[] = {
+        { std::regex(R"#(\b(del|delivery|clnc|clearance)\b)#",    std::regex::icase), FAC_DELIVERY  },
+        { std::regex(R"#(\b(gnd|ground|ramp|apron)\b)#",          std::regex::icase), FAC_GROUND    },
+        { std::regex(R"#(\b(twr|tower)\b)#",                      std::regex::icase), FAC_TOWER     },
+        { std::regex(R"#(\b(dep|departure)\b)#",                  std::regex::icase), FAC_DEPARTURE },
+        { std::regex(R"#(\b(app|approach|arr|arrival|final|tracon)\b)#", std::regex::icase), FAC_APPROACH },
+        { std::regex(R"#(\b(ctr|center|centre|control|radar)\b)#", std::regex::icase), FAC_CENTER   },
+        { std::regex(R"#(\batis\b)#",                             std::regex::icase), FAC_ATIS      },
+    };
+    
+    unsigned fac = FAC_NONE;
+    for (const auto& re: RE_FAC)
+        if (std::regex_search(streamName, re.first))
+            fac |= re.second;
+    return fac;
+}
+
+/// The flight phase defines which facilities come next, in order.
+/// The likelihood decreases along that order.
+/// Facilities the pilot is already tuned to are skipped.
+std::vector<FacilityLikelihoodTy> PredictNextFacilities (FlightPhaseTy phase, unsigned currFac)
+{
+    std::vector<FacilityTy> vSeq;
+    switch (phase) {
+        case PHASE_PARKED:      vSeq = { FAC_DELIVERY, FAC_GROUND };        break;
+        case PHASE_TAXI_OUT:    vSeq = { FAC_TOWER, FAC_GROUND };           break;
+        case PHASE_TAKEOFF:     vSeq = { FAC_DEPARTURE, FAC_CENTER };       break;
+        case PHASE_CLIMB:       vSeq = { FAC_DEPARTURE, FAC_CENTER };       break;
+        case PHASE_CRUISE:      vSeq = { FAC_CENTER, FAC_APPROACH };        break;
+        case PHASE_DESCENT:     vSeq = { FAC_APPROACH, FAC_TOWER };         break;
+        case PHASE_APPROACH:    vSeq = { FAC_TOWER, FAC_APPROACH };         break;
+        case PHASE_LANDING:     vSeq = { FAC_GROUND, FAC_TOWER };           break;
+        case PHASE_TAXI_IN:     vSeq = { FAC_GROUND };                      break;
+        default:                break;
+    }
+    
+    std::vector<FacilityLikelihoodTy> vRet;
+    double likelihood = 0.8;
+    for (FacilityTy fac: vSeq) {
+        if (fac & currFac)
+            continue;
+        vRet.emplace_back(fac, likelihood);
+        likelihood /= 2.0;
+    }
+    return vRet;
+}
+
+//
+// MARK: FlightPhaseDetectorTy
+//
+
+/// - On the ground the speed decides between parked, taxiing, and
+///   takeoff/landing roll, having flown before decides which of them.
+///   After landing, the plane only counts as parked once it stood still
+///   for `PHASE_PARKED_HOLD_S`, as pilots stop on the way in.
+/// - In the air the smoothed vertical speed decides between climb,
+///   level, and descent, speed then tells descent from approach.
+void FlightPhaseDetectorTy::Update ()
+{
+    const std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+    const double elev_m = dataRefs.GetPlaneElev_m();
+    const double speed_kn = dataRefs.GetPlaneTAS_kn();
+    
+    // vertical speed from elevation change since last call
+    if (!std::isnan(lastElev_m) && tLast != std::chrono::time_point<std::chrono::steady_clock>()) {
+        const double dt = std::chrono::duration<double>(now - tLast).count();
+        if (dt > 0.0)
+            vsi_fpm += PHASE_VSI_SMOOTH * ((elev_m - lastElev_m) / dt / Ms_per_FTm - vsi_fpm);
+    }
+    lastElev_m = elev_m;
+    tLast = now;
+    
+    FlightPhaseTy newPhase = PHASE_UNKNOWN;
+    if (dataRefs.IsPlaneOnGround() && speed_kn < PHASE_PARKED_KN) {
+        if (tStopped == std::chrono::time_point<std::chrono::steady_clock>())
+            tStopped = now;
+        // stopped after landing? Keep taxiing in until the hold time is over
+        if (phase == PHASE_TAXI_IN &&
+            now - tStopped < std::chrono::seconds(PHASE_PARKED_HOLD_S))
+            newPhase = PHASE_TAXI_IN;
+        else {
+            newPhase = PHASE_PARKED;
+            bFlown = false;
+        }
+    } else if (dataRefs.IsPlaneOnGround()) {
+        tStopped = std::chrono::time_point<std::chrono::steady_clock>();
+        if (speed_kn < PHASE_TAXI_KN)
+            newPhase = bFlown ? PHASE_TAXI_IN : PHASE_TAXI_OUT;
+        else
+            newPhase = bFlown ? PHASE_LANDING : PHASE_TAKEOFF;
+    } else {
+        tStopped = std::chrono::time_point<std::chrono::steady_clock>();
+        bFlown = true;
+        if (vsi_fpm > PHASE_CLIMB_FPM)
+            newPhase = PHASE_CLIMB;
+        else if (vsi_fpm < -PHASE_CLIMB_FPM)
+            newPhase = speed_kn < PHASE_APPROACH_KN ? PHASE_APPROACH : PHASE_DESCENT;
+        else
+            newPhase = PHASE_CRUISE;
+    }
+    
+    if (newPhase != phase) {
+        LOG_MSG(logDEBUG, DBG_PHASE_CHANGE, GetPhaseStr(phase), GetPhaseStr(newPhase));
+        phase = newPhase;
+    }
+}
+
+// Forget all history
+void FlightPhaseDetectorTy::Reset ()
+{
+    phase = PHASE_UNKNOWN;
+    bFlown = false;
+    lastElev_m = NAN;
+    vsi_fpm = 0.0;
+    tLast = std::chrono::time_point<std::chrono::steady_clock>();
+    tStopped = std::chrono::time_point<std::chrono::steady_clock>();
+}
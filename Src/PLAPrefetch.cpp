@@ -0,0 +1,343 @@
+//
+//  PLAPrefetch.cpp
+//  PlayLiveATC
+//
+// Prefetches LiveATC streams for the airports of the loaded flight plan
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only flight plan prefetcher
+FeedPrefetchTy gPrefetch;
+
+//
+// MARK: FeedPrefetchTy
+//
+
+/// Called regularly from the flight loop. Starts a background fetch if
+/// - no fetch is running right now, and
+/// - the airports of interest changed or the prefetched data is outdated.
+///
+/// Airports of interest are those the channels are currently tuned to
+/// (needed for predicting the next frequency) and
+/// the flight plan's airports (if prefetching is enabled).
+void FeedPrefetchTy::CheckAirports ()
+{
+    // airport positions are needed, so wait for the airport table
+    if (IsFetching() || !gAirports.IsLoaded())
+        return;
+    
+    // Did anything change?
+    std::vector<std::string> vAirports;
+    if (dataRefs.ShallPredictNextFrequ()) {
+        for (const COMChannel& chn: gChn) {
+            const ChnStatusTy st = chn.GetStatusSnapshot();
+            if (st.airportIcao[0] &&
+                std::find(vAirports.cbegin(), vAirports.cend(), st.airportIcao) == vAirports.cend())
+                vAirports.emplace_back(st.airportIcao);
+        }
+    }
+    if (dataRefs.ShallPrefetchFlightPlan()) {
+        for (std::string& icao: ReadFlightPlanAirports())
+            if (vAirports.size() < PREFETCH_MAX_AIRPORTS &&
+                std::find(vAirports.cbegin(), vAirports.cend(), icao) == vAirports.cend())
+                vAirports.emplace_back(std::move(icao));
+    }
+    if (vAirports.empty())
+        return;
+    bool bOutdated = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bOutdated = std::chrono::steady_clock::now() - tFetched > std::chrono::seconds(PREFETCH_MAX_AGE_S);
+    }
+    if (!bOutdated && vAirports == vPlanAirports)
+        return;
+    
+    // determine the airports' positions here in the main thread
+    std::vector<std::pair<std::string,positionTy>> vApPos;
+    for (const std::string& icao: vAirports) {
+        const positionTy pos = gAirports.Find(icao);
+        if (!std::isnan(pos.lat()))
+            vApPos.emplace_back(icao, pos);
+    }
+    if (vApPos.empty())
+        return;
+    
+    // start fetching in the background, least important of all tasks
+    bAbort = false;
+    gWorkers.Post(WORK_PREFETCH, WORK_NO_CHN,
+                  [this,vApPos]{ Fetch(vApPos); });
+    // only now these airports count as handled
+    vPlanAirports = vAirports;
+}
+
+// Returns the streams prefetched for a frequency
+bool FeedPrefetchTy::LookupFrequ (const std::string& frequ, LiveATCDataMapTy& mapAp) const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (std::chrono::steady_clock::now() - tFetched > std::chrono::seconds(PREFETCH_MAX_AGE_S))
+        return false;
+    const auto iter = mapFrequ.find(frequ);
+    if (iter == mapFrequ.end() || iter->second.empty())
+        return false;
+    LOG_MSG(logDEBUG, DBG_PREFETCH_HIT, frequ.c_str());
+    mapAp = iter->second;
+    return true;
+}
+
+// Returns LiveATC's frequency search page as prefetched
+bool FeedPrefetchTy::LookupSearch (const std::string& frequ, std::string& page) const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (std::chrono::steady_clock::now() - tFetched > std::chrono::seconds(PREFETCH_MAX_AGE_S))
+        return false;
+    const auto iter = mapSearch.find(frequ);
+    if (iter == mapSearch.end())
+        return false;
+    LOG_MSG(logDEBUG, DBG_PREFETCH_SEARCH, frequ.c_str());
+    page = iter->second;
+    return true;
+}
+
+// Returns all streams prefetched for an airport
+bool FeedPrefetchTy::LookupAirport (const std::string& icao,
+                                    std::vector<std::pair<int,LiveATCDataTy>>& vFeeds) const
+{
+    vFeeds.clear();
+    std::lock_guard<std::mutex> lock(mtx);
+    if (std::chrono::steady_clock::now() - tFetched > std::chrono::seconds(PREFETCH_MAX_AGE_S))
+        return false;
+    for (const auto& f: mapFrequ) {
+        const LiveATCDataMapTy::const_iterator apIter = f.second.find(icao);
+        if (apIter != f.second.cend())
+            // frequency key is "###.###", turn it back into XP's format
+            vFeeds.emplace_back(int(std::lround(std::stod(f.first) * 1000.0)),
+                                apIter->second);
+    }
+    return !vFeeds.empty();
+}
+
+/// Example for https://www.liveatc.net/play/kjfk_gnd.pls :
+///      [playlist]
+///      File1=http://d.liveatc.net/kjfk_gnd
+///      Title1=KJFK Ground
+///      Length1=-1
+bool FeedPrefetchTy::ResolvePls (const std::string& plsUrl, std::string& url)
+{
+    // resolved before, recently enough?
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto iter = mapPls.find(plsUrl);
+        if (iter != mapPls.end()) {
+            if (std::chrono::steady_clock::now() - iter->second.t <= std::chrono::seconds(PREFETCH_MAX_AGE_S)) {
+                url = iter->second.url;
+                return true;
+            }
+            mapPls.erase(iter);
+        }
+    }
+    
+    // fetch and parse the playlist
+    std::string playlist;
+    url.clear();
+    if (!HttpGet(plsUrl, playlist))
+        return false;
+    static std::regex rePlsFile1 ( R"#(File1=(http\S+))#" );
+    std::smatch m;
+    if (!std::regex_search(playlist, m, rePlsFile1)) {
+        LOG_MSG(logWARN, WARN_RE_ICAO, "File1");
+        return true;
+    }
+    url = m[1].str();
+    
+    // remember for next time
+    std::lock_guard<std::mutex> lock(mtx);
+    mapPls[plsUrl] = PlsTy{ url, std::chrono::steady_clock::now() };
+    return true;
+}
+
+// Stops a running background fetch (blocking) and clears all prefetched data
+void FeedPrefetchTy::Stop ()
+{
+    bAbort = true;
+    gWorkers.Cancel(WORK_NO_CHN);
+    gWorkers.WaitIdle(WORK_NO_CHN);
+    vPlanAirports.clear();
+    
+    std::lock_guard<std::mutex> lock(mtx);
+    mapFrequ.clear();
+    mapSearch.clear();
+    mapPls.clear();
+    tFetched = std::chrono::time_point<std::chrono::steady_clock>();
+}
+
+/// Departure and destination are the first and last airport in the
+/// flight plan, they come first. Other airports in between
+/// (like an alternate entered as waypoint) follow as long as there is room.
+std::vector<std::string> FeedPrefetchTy::ReadFlightPlanAirports ()
+{
+    std::vector<std::string> vAll;
+    const int n = XPLMCountFMSEntries();
+    for (int i = 0; i < n; i++) {
+        XPLMNavType navType = xplm_Nav_Unknown;
+        char szId[256] = "";
+        XPLMGetFMSEntryInfo(i, &navType, szId, NULL, NULL, NULL, NULL);
+        if (navType == xplm_Nav_Airport && *szId &&
+            std::find(vAll.cbegin(), vAll.cend(), szId) == vAll.cend())
+            vAll.emplace_back(szId);
+    }
+    
+    // departure and destination first
+    if (vAll.size() <= 2)
+        return vAll;
+    std::vector<std::string> vAirports { vAll.front(), vAll.back() };
+    for (auto iter = std::next(vAll.cbegin());
+         iter != std::prev(vAll.cend()) && vAirports.size() < PREFETCH_MAX_AIRPORTS;
+         ++iter)
+        vAirports.push_back(*iter);
+    return vAirports;
+}
+
+/// Queries LiveATC for each airport, then collects each stream
+/// under all frequencies listed in its facilities table.
+/// Per frequency and airport the most specific stream
+/// (least facilities) is kept, like in StreamCtrlTy::ParseForAirportStreams().
+/// Then runs LiveATC's frequency search for each frequency found,
+/// so that tuning it later needs no search of its own.
+/// Finally resolves all `.pls` playlists.
+void FeedPrefetchTy::Fetch (std::vector<std::pair<std::string,positionTy>> vAirports)
+{
+    const std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    {
+        std::string sAirports;
+        for (const auto& ap: vAirports)
+            sAirports += (sAirports.empty() ? "" : ", ") + ap.first;
+        LOG_MSG(logINFO, MSG_PREFETCH_START, sAirports.c_str());
+    }
+    
+    std::map<std::string,LiveATCDataMapTy> mapNew;
+    std::vector<std::string> vPlsUrls;
+    std::string readBuf;
+    int nStreams = 0;
+    static std::regex reFrequ ( R"#(>\s*(1[1-3]\d\.\d{1,3})\s*<)#" );
+    
+    for (const auto& ap: vAirports)
+    {
+        if (bAbort) return;
+        
+        // query LiveATC for the airport
+        char url[100];
+        snprintf(url, sizeof(url), LIVE_ATC_AP_URL, ap.first.c_str());
+        if (!HttpGet(url, readBuf))
+            continue;
+        
+        // pass over the reply, stream section by stream section
+        for (std::string::size_type
+             pos = readBuf.find(LIVE_ATC_SECTION),
+             nextPos = std::string::npos;
+             pos != std::string::npos;
+             pos = nextPos)
+        {
+            nextPos = readBuf.find(LIVE_ATC_SECTION, pos+1);
+            const std::string apSec(readBuf.substr(pos, nextPos-pos));
+            
+            // only streams of the airport we asked for
+            LiveATCDataTy streamData;
+            if (!ParseFeedSection(apSec, streamData) ||
+                streamData.airportIcao != ap.first)
+                continue;
+            streamData.airportPos = ap.second;
+            
+            // the frequencies are listed in the facilities table
+            const std::string::size_type posTable = apSec.find("<table class=\"freqTable\"");
+            if (posTable == std::string::npos)
+                continue;
+            nStreams++;
+            if (endsWith(streamData.playUrl, LIVE_ATC_PLS) &&
+                std::find(vPlsUrls.cbegin(), vPlsUrls.cend(), streamData.playUrl) == vPlsUrls.cend())
+                vPlsUrls.push_back(streamData.playUrl);
+            
+            for (std::sregex_iterator iter(apSec.cbegin() + posTable, apSec.cend(), reFrequ);
+                 iter != std::sregex_iterator();
+                 ++iter)
+            {
+                // same format as StreamCtrlTy::SetFrequ()
+                const int kHz = int(std::lround(std::stod((*iter)[1].str()) * 1000.0));
+                char szFrequ[20];
+                snprintf(szFrequ, sizeof(szFrequ), "%d.%03d", kHz / 1000, kHz % 1000);
+                
+                LiveATCDataMapTy& mapAp = mapNew[szFrequ];
+                const LiveATCDataMapTy::iterator apIter = mapAp.find(streamData.airportIcao);
+                if (apIter == mapAp.end())
+                    mapAp.emplace(streamData.airportIcao, streamData);
+                else if (streamData.nFacilities < apIter->second.nFacilities)
+                    apIter->second = streamData;
+            }
+        }
+    }
+    
+    // the frequency searches, they list all airports sharing a frequency
+    std::map<std::string,std::string> mapNewSearch;
+    for (const auto& f: mapNew) {
+        if (bAbort) return;
+        char url[100];
+        snprintf(url, sizeof(url), LIVE_ATC_URL, f.first.c_str());
+        if (HttpGet(url, readBuf))
+            mapNewSearch.emplace(f.first, std::move(readBuf));
+    }
+    
+    // resolve the playlists, they are cached by ResolvePls
+    int nPls = 0;
+    for (const std::string& plsUrl: vPlsUrls) {
+        if (bAbort) return;
+        std::string url;
+        if (ResolvePls(plsUrl, url) && !url.empty())
+            nPls++;
+    }
+    
+    // make the result available
+    std::lock_guard<std::mutex> lock(mtx);
+    mapFrequ.swap(mapNew);
+    mapSearch.swap(mapNewSearch);
+    tFetched = std::chrono::steady_clock::now();
+    // and forget outdated playlists
+    for (auto iter = mapPls.begin(); iter != mapPls.end(); )
+        if (tFetched - iter->second.t > std::chrono::seconds(PREFETCH_MAX_AGE_S))
+            iter = mapPls.erase(iter);
+        else
+            ++iter;
+    LOG_MSG(logINFO, MSG_PREFETCH_DONE, nStreams, int(mapFrequ.size()), int(mapSearch.size()), nPls,
+            std::chrono::duration<double>(tFetched - tStart).count());
+}
+
+// Is the background fetch queued or running?
+bool FeedPrefetchTy::IsFetching () const
+{
+    return gWorkers.IsBusy(WORK_NO_CHN);
+}
@@ -0,0 +1,194 @@
+//
+//  PLAReplay.cpp
+//  PlayLiveATC
+//
+// "Say again": Per channel history of received audio in a memory-mapped
+// ring file, and the index of transmissions to replay the last one from
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+#if !(IBM)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//
+// MARK: ReplayRingTy
+//
+
+/// The file gets its full size right away, so that writing into the
+/// mapping never extends it. Its previous content is just overwritten.
+bool ReplayRingTy::Open (const std::string& filePath, int minutes)
+{
+    Close();
+    path = filePath;
+    nFrames = uint64_t(minutes) * 60 * 1000 / AUDIO_BUF_MS;
+    const uint64_t sz = nFrames * REPLAY_FRAME_SAMPLES;
+    if (!sz)
+        return false;
+    
+#if IBM
+    hFile = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile != INVALID_HANDLE_VALUE)
+        hMap = CreateFileMappingA(hFile, NULL, PAGE_READWRITE,
+                                  DWORD(sz >> 32), DWORD(sz & 0xFFFFFFFF), NULL);
+    if (hMap)
+        pMap = static_cast<uint8_t*>(MapViewOfFile(hMap, FILE_MAP_ALL_ACCESS, 0, 0, size_t(sz)));
+    if (!pMap) {
+        LOG_MSG(logERR, ERR_REPLAY_OPEN, path.c_str(),
+                ("error " + std::to_string(GetLastError())).c_str());
+        Close();
+        return false;
+    }
+#else
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && ftruncate(fd, off_t(sz)) == 0) {
+        void* p = mmap(nullptr, size_t(sz), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED)
+            pMap = static_cast<uint8_t*>(p);
+    }
+    if (!pMap) {
+        char sErr[SERR_LEN];
+        strerror_s(sErr, sizeof(sErr), errno);
+        LOG_MSG(logERR, ERR_REPLAY_OPEN, path.c_str(), sErr);
+        Close();
+        return false;
+    }
+#endif
+    
+    wrFrame = 0;
+    bInTx = false;
+    nTx = 0;
+    LOG_MSG(logDEBUG, DBG_REPLAY_OPEN, minutes, path.c_str());
+    return true;
+}
+
+// Unmap and close the file
+void ReplayRingTy::Close ()
+{
+#if IBM
+    if (pMap)
+        UnmapViewOfFile(pMap);
+    if (hMap)
+        CloseHandle(hMap);
+    if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+    hMap = NULL;
+    hFile = INVALID_HANDLE_VALUE;
+#else
+    if (pMap)
+        munmap(pMap, size_t(nFrames * REPLAY_FRAME_SAMPLES));
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+#endif
+    pMap = nullptr;
+}
+
+/// Silence is not recorded, it only ends a transmission,
+/// so of a silent period only its first frame is queued.
+/// Never blocks: If the executor falls behind, frames are dropped.
+void ReplayRingTy::Record (const float* samples, bool bSignal)
+{
+    if (!bSignal && !bQueuedTx)
+        return;
+    ReplayFrameTy fr;
+    std::copy(samples, samples + REPLAY_FRAME_SAMPLES, fr.samples.begin());
+    fr.bSignal = bSignal;
+    fr.t = std::chrono::steady_clock::now();
+    if (queue.Push(std::move(fr)))
+        bQueuedTx = bSignal;
+    else
+        cntDropped++;
+}
+
+/// A new transmission starts with the first frame carrying a signal.
+/// Called regularly from the channel's tick, and before reading.
+void ReplayRingTy::Store ()
+{
+    ReplayFrameTy fr;
+    while (queue.Pop(fr)) {
+        if (!pMap)
+            continue;
+        const uint64_t f = wrFrame;
+        
+        // end or start of a transmission
+        if (fr.bSignal != bInTx) {
+            if (fr.bSignal)
+                txs[nTx++ % REPLAY_TX_MAX] = {f, 0, fr.t};
+            else
+                txs[(nTx - 1) % REPLAY_TX_MAX].endFrame = f;
+            bInTx = fr.bSignal;
+        }
+        if (!fr.bSignal)
+            continue;
+        
+        // sequential write into the mapped file
+        uint8_t* p = pMap + (f % nFrames) * REPLAY_FRAME_SAMPLES;
+        for (size_t i = 0; i < REPLAY_FRAME_SAMPLES; i++)
+            p[i] = ULawEncode(int16_t(std::clamp(fr.samples[i], -1.0f, 1.0f) * 32767.0f));
+        wrFrame = f + 1;
+    }
+    
+    const unsigned long nDropped = cntDropped.exchange(0);
+    if (nDropped)
+        LOG_MSG(logWARN, WARN_REPLAY_DROPPED, nDropped);
+}
+
+/// A transmission still being received is skipped,
+/// "say again" refers to the one before.
+bool ReplayRingTy::GetLastTx (std::vector<float>& samples,
+                              std::chrono::time_point<std::chrono::steady_clock>& tStart) const
+{
+    samples.clear();
+    if (!pMap)
+        return false;
+    
+    // find the last complete transmission
+    size_t k = nTx;
+    while (k > 0 && k + REPLAY_TX_MAX > nTx && !txs[(k - 1) % REPLAY_TX_MAX].endFrame)
+        k--;
+    if (k == 0 || k + REPLAY_TX_MAX <= nTx)
+        return false;
+    const ReplayTxTy& tx = txs[(k - 1) % REPLAY_TX_MAX];
+    
+    // still in the ring, not about to be overwritten?
+    if (wrFrame - tx.startFrame + REPLAY_SAFETY_FRAMES > nFrames)
+        return false;
+    
+    // decode
+    tStart = tx.tStart;
+    const std::array<float,256>& tbl = ULawTable();
+    samples.reserve(size_t(tx.endFrame - tx.startFrame) * REPLAY_FRAME_SAMPLES);
+    for (uint64_t f = tx.startFrame; f < tx.endFrame; f++) {
+        const uint8_t* p = pMap + (f % nFrames) * REPLAY_FRAME_SAMPLES;
+        for (size_t i = 0; i < REPLAY_FRAME_SAMPLES; i++)
+            samples.push_back(tbl[p[i]]);
+    }
+    return !samples.empty();
+}
@@ -0,0 +1,199 @@
+//
+//  PLATimers.cpp
+//  PlayLiveATC
+//
+// Hierarchical timer wheel for periodic and one-shot jobs,
+// advanced by the flight loop
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only timer wheel
+TimerWheelTy gTimers;
+
+//
+// MARK: TimerWheelTy
+//
+
+// Register a job, which is not yet started
+TimerIdTy TimerWheelTy::Add (int chn, std::function<void()> fn)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    const TimerIdTy id = nextId++;
+    JobTy& job = jobs[id];
+    job.chn = chn;
+    job.fn = std::move(fn);
+    return id;
+}
+
+// (Re)Start a job, replaces any earlier due time
+bool TimerWheelTy::Start (TimerIdTy id, int delayMs, int periodMs)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    auto iter = jobs.find(id);
+    if (iter == jobs.end())
+        return false;
+    // due at the earliest in the next tick, round up to full ticks
+    const unsigned long delay = std::max(1UL, (unsigned long)((std::max(delayMs, 0) + TIMER_RES_MS - 1) / TIMER_RES_MS));
+    iter->second.period = periodMs > 0 ? std::max(1UL, (unsigned long)(periodMs / TIMER_RES_MS)) : 0;
+    iter->second.due = currTick + delay - 1;
+    Insert({id, ++iter->second.gen, iter->second.due});
+    return true;
+}
+
+// Stop a job, it stays registered
+void TimerWheelTy::Stop (TimerIdTy id)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    auto iter = jobs.find(id);
+    if (iter != jobs.end()) {
+        iter->second.due = 0;
+        iter->second.gen++;         // slot entries become stale
+    }
+}
+
+// Stop all jobs of a channel
+void TimerWheelTy::StopChn (int chn)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& p: jobs)
+        if (p.second.chn == chn) {
+            p.second.due = 0;
+            p.second.gen++;
+        }
+}
+
+// Remove a job
+void TimerWheelTy::Remove (TimerIdTy id)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    jobs.erase(id);
+}
+
+// Remove all jobs of a channel
+void TimerWheelTy::RemoveChn (int chn)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto iter = jobs.begin(); iter != jobs.end();) {
+        if (iter->second.chn == chn)
+            iter = jobs.erase(iter);
+        else
+            ++iter;
+    }
+}
+
+// Remove all jobs, logs statistics
+void TimerWheelTy::Clear ()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    jobs.clear();
+    for (SlotTy& s: wheel0) s.clear();
+    for (SlotTy& s: wheel1) s.clear();
+    LOG_MSG(logDEBUG, DBG_TIMERS_STATS, cntFired, maxFired);
+    cntFired = maxFired = 0;
+}
+
+/// Processes all ticks passed since the last call one by one.
+/// Due jobs are collected under the lock, but executed
+/// only after the lock is released, so that jobs can start
+/// and stop jobs themselves.
+unsigned long TimerWheelTy::Advance ()
+{
+    std::vector<std::function<void()>> due;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const unsigned long nowTick = (unsigned long)
+        (std::chrono::duration_cast<std::chrono::milliseconds>
+         (std::chrono::steady_clock::now() - tStart).count() / TIMER_RES_MS);
+        for (; currTick <= nowTick; currTick++) {
+            // new round of level 0 begins? Then fetch this round's jobs from level 1
+            if (currTick % TIMER_SLOTS == 0)
+                Cascade();
+            
+            // process all entries of this tick
+            SlotTy slot;
+            slot.swap(wheel0[currTick % TIMER_SLOTS]);
+            for (const SlotEntryTy& e: slot) {
+                // skip stale entries of removed, stopped, or restarted jobs
+                if (!IsCurrent(e))
+                    continue;
+                JobTy& job = jobs.find(e.id)->second;
+                due.push_back(job.fn);
+                // periodic job: next execution, one-shot: done
+                // (if we are lagging behind then don't try to catch up)
+                if (job.period) {
+                    job.due = std::max(job.due + job.period, currTick + 1);
+                    Insert({e.id, job.gen, job.due});
+                } else
+                    job.due = 0;
+            }
+        }
+        cntFired += (unsigned long)due.size();
+        maxFired = std::max(maxFired, (unsigned long)due.size());
+    }
+    
+    // execute the due jobs outside the lock
+    for (std::function<void()>& fn: due)
+        fn();
+    return (unsigned long)due.size();
+}
+
+/// Level 0 is used if due within the current round so that the slot
+/// is reached before being reused. Otherwise the entry goes to level 1
+/// into its round's slot, or, if too far out, into the last
+/// slot level 1 can reach. From there it is moved along by Cascade().
+void TimerWheelTy::Insert (const SlotEntryTy& e)
+{
+    if (e.due - currTick < TIMER_SLOTS - currTick % TIMER_SLOTS)
+        wheel0[e.due % TIMER_SLOTS].push_back(e);
+    else {
+        const unsigned long currRound = currTick / TIMER_SLOTS;
+        const unsigned long round = std::min(e.due / TIMER_SLOTS,
+                                             currRound + TIMER_SLOTS - 1);
+        wheel1[round % TIMER_SLOTS].push_back(e);
+    }
+}
+
+// Is the entry still current for its job?
+bool TimerWheelTy::IsCurrent (const SlotEntryTy& e) const
+{
+    auto iter = jobs.find(e.id);
+    return iter != jobs.end() && iter->second.due && iter->second.gen == e.gen;
+}
+
+/// Entries due in this round go to level 0,
+/// entries further out are inserted again into level 1.
+void TimerWheelTy::Cascade ()
+{
+    SlotTy slot;
+    slot.swap(wheel1[(currTick / TIMER_SLOTS) % TIMER_SLOTS]);
+    for (const SlotEntryTy& e: slot)
+        if (IsCurrent(e))
+            Insert(e);
+}
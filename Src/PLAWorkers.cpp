@@ -0,0 +1,170 @@
+//
+//  PLAWorkers.cpp
+//  PlayLiveATC
+//
+// Small fixed pool of worker threads executing stream control tasks
+// by priority
+//
+
+/*
+ * Copyright (c) 2019, Birger Hoppe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "PlayLiveATC.h"
+
+//
+// MARK: Globals
+//
+
+// the one and only worker pool
+WorkerPoolTy gWorkers;
+
+//
+// MARK: WorkerPoolTy
+//
+
+// Start `n` worker threads
+void WorkerPoolTy::Start (int n)
+{
+    if (!threads.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = false;
+        cntDone = cntCancelled = 0;
+    }
+    for (int i = 0; i < n; i++)
+        threads.emplace_back(&WorkerPoolTy::Run, this);
+    LOG_MSG(logDEBUG, DBG_WORKERS_START, n);
+}
+
+// Stop all worker threads, waits for running tasks, drops queued ones
+void WorkerPoolTy::Stop ()
+{
+    if (threads.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+        cntCancelled += (unsigned long)tasks.size();
+        tasks.clear();
+    }
+    cv.notify_all();
+    for (std::thread& t: threads)
+        t.join();
+    threads.clear();
+    LOG_MSG(logDEBUG, DBG_WORKERS_STOP, cntDone, cntCancelled);
+}
+
+// Queue a task
+void WorkerPoolTy::Post (WorkPrioTy prio, int chn, std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.push_back({prio, nextSeq++, chn, std::move(fn)});
+    }
+    cv.notify_all();
+}
+
+// Remove queued tasks of a channel
+int WorkerPoolTy::Cancel (int chn, WorkPrioTy maxPrio)
+{
+    int n = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto iter = tasks.begin(); iter != tasks.end(); ) {
+            if (iter->chn == chn && iter->prio <= maxPrio) {
+                iter = tasks.erase(iter);
+                n++;
+            } else
+                ++iter;
+        }
+        cntCancelled += (unsigned long)n;
+    }
+    if (n)
+        cv.notify_all();
+    return n;
+}
+
+// Is a task of this channel queued or running?
+bool WorkerPoolTy::IsBusy (int chn, WorkPrioTy maxPrio) const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return IsRunning(chn, maxPrio) ||
+    std::any_of(tasks.cbegin(), tasks.cend(),
+                [chn,maxPrio](const TaskTy& t){ return t.chn == chn && t.prio <= maxPrio; });
+}
+
+// Wait till no task of this channel is queued or running
+void WorkerPoolTy::WaitIdle (int chn)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this,chn]{
+        return threads.empty() || bStop ||
+        (!IsRunning(chn) &&
+         std::none_of(tasks.cbegin(), tasks.cend(),
+                      [chn](const TaskTy& t){ return t.chn == chn; }));
+    });
+}
+
+/// Waits for a task to become available, executes it outside the lock,
+/// and starts over until the pool is stopped.
+void WorkerPoolTy::Run ()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+        std::list<TaskTy>::iterator iter = tasks.end();
+        cv.wait(lock, [this,&iter]{ return bStop || (iter = NextTask()) != tasks.end(); });
+        if (bStop)
+            return;
+        
+        // take the task out of the queue and mark its channel busy
+        TaskTy task = std::move(*iter);
+        tasks.erase(iter);
+        busyChn.emplace_back(task.chn, task.prio);
+        
+        // execute it without holding the lock
+        lock.unlock();
+        task.fn();
+        lock.lock();
+        
+        // channel no longer busy, might allow the next task to run
+        busyChn.erase(std::find(busyChn.begin(), busyChn.end(),
+                                std::make_pair(task.chn, task.prio)));
+        cntDone++;
+        cv.notify_all();
+    }
+}
+
+// Find the most urgent task whose channel is not busy
+std::list<WorkerPoolTy::TaskTy>::iterator WorkerPoolTy::NextTask ()
+{
+    std::list<TaskTy>::iterator best = tasks.end();
+    for (auto iter = tasks.begin(); iter != tasks.end(); ++iter) {
+        if (IsRunning(iter->chn))
+            continue;
+        if (best == tasks.end() ||
+            iter->prio > best->prio ||
+            (iter->prio == best->prio && iter->seq < best->seq))
+            best = iter;
+    }
+    return best;
+}
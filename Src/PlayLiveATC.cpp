@@ -51,6 +51,7 @@ enum menuItems {
     MENU_ID_VOLUME_DOWN,
     MENU_ID_MUTE,
     MENU_ID_SUB_AUDIO_DEVICE,
+    MENU_ID_SUB_AUDIO_ROUTES,
     MENU_ID_SETTINGS_UI,
     MENU_ID_HELP,
 #ifdef DEBUG
@@ -65,6 +66,13 @@ int aMenuItems[CNT_MENU_ID];
 
 /// ID of the "Output Device" submenu within the PlayLiveATC menu
 XPLMMenuID menuIDOutputDev = 0;
+/// ID of the "Additional Audio Outputs" submenu within the PlayLiveATC menu
+XPLMMenuID menuIDRoutes = 0;
+
+/// Menu item refs of additional channels start here, ref = base + channel index
+constexpr long long MENU_ID_TOGGLE_CHN_BASE = 1000;
+/// Menu items of additional channels (beyond COM1/COM2)
+std::vector<int> aMenuItemsChn;
 
 // set checkmarks according to current settings
 void MenuUpdateCheckmarks()
@@ -73,6 +81,9 @@ void MenuUpdateCheckmarks()
         dataRefs.ShallActOnCom(0) ? xplm_Menu_Checked : xplm_Menu_Unchecked);
     XPLMCheckMenuItem(menuID, aMenuItems[MENU_ID_TOGGLE_COM2],
         dataRefs.ShallActOnCom(1) ? xplm_Menu_Checked : xplm_Menu_Unchecked);
+    for (size_t i = 0; i < aMenuItemsChn.size(); i++)
+        XPLMCheckMenuItem(menuID, aMenuItemsChn[i],
+            dataRefs.ShallActOnCom(COM_CNT_XP + int(i)) ? xplm_Menu_Checked : xplm_Menu_Unchecked);
 
     // checkmarks for the audio device selection
     for (int i = 0;
@@ -82,6 +93,10 @@ void MenuUpdateCheckmarks()
         // place a check mark if this is the current device
         XPLMCheckMenuItem(menuIDOutputDev, i,
             dataRefs.GetAudioDev() == gVLCOutputDevs[i].device() ? xplm_Menu_Checked : xplm_Menu_NoCheck);
+        // ...and if the mix is routed there additionally
+        if (menuIDRoutes)
+            XPLMCheckMenuItem(menuIDRoutes, i,
+                dataRefs.IsAudioRoute(gVLCOutputDevs[i].device()) ? xplm_Menu_Checked : xplm_Menu_NoCheck);
     }
 }
 
@@ -101,7 +116,19 @@ void MenuHandlerAudioDevices(void * /*mRef*/, void * iRef)
     }
 }
 
-/// (Re)creates the sub menu for selection of the audio output device
+/// Menu handler for additional audio outputs, toggles the device
+/// @param iRef Is actually a pointer to a string with the device id
+void MenuHandlerAudioRoutes(void * /*mRef*/, void * iRef)
+{
+    if (iRef) {
+        dataRefs.ToggleAudioRoute(reinterpret_cast<const char*>(iRef));
+        gMixer.SetRoutes(dataRefs.GetAudioRoutes());
+        MenuUpdateCheckmarks();
+    }
+}
+
+/// (Re)creates the sub menus for selection of the audio output device
+/// and of additional audio outputs
 bool MenuAudioDevices()
 {
     // update the list of audio devices
@@ -119,11 +146,25 @@ bool MenuAudioDevices()
         // remove any existing menu items
         XPLMClearAllMenuItems(menuIDOutputDev);
     }
+    
+    // same for additional outputs, which only the audio mixer supports
+    if (!menuIDRoutes) {
+        aMenuItems[MENU_ID_SUB_AUDIO_ROUTES] =
+            XPLMAppendMenuItem(menuID, MENU_AUDIO_ROUTES, NULL, 1);
+        menuIDRoutes = XPLMCreateMenu(MENU_AUDIO_ROUTES, menuID,
+            aMenuItems[MENU_ID_SUB_AUDIO_ROUTES], MenuHandlerAudioRoutes, NULL);
+        if (!menuIDRoutes) { LOG_MSG(logERR, ERR_CREATE_MENU, MENU_AUDIO_ROUTES); return false; }
+    }
+    else {
+        XPLMClearAllMenuItems(menuIDRoutes);
+    }
+    XPLMEnableMenuItem(menuID, aMenuItems[MENU_ID_SUB_AUDIO_ROUTES], gMixer.IsActive());
 
     // add one menu item per available output device
     // using the description as item name and the device id as item reference
     if (gVLCOutputDevs.empty()) {
         XPLMAppendMenuItem(menuIDOutputDev, MENU_NO_DEVICE, NULL, 1);
+        XPLMAppendMenuItem(menuIDRoutes, MENU_NO_DEVICE, NULL, 1);
     }
     else {
         for (const VLC::AudioOutputDeviceDescription& dev : gVLCOutputDevs) {
@@ -131,6 +172,9 @@ bool MenuAudioDevices()
             XPLMAppendMenuItem(menuIDOutputDev,
                 dev.description().c_str(),
                 (void*)dev.device().c_str(), 1);
+            XPLMAppendMenuItem(menuIDRoutes,
+                dev.description().c_str(),
+                (void*)dev.device().c_str(), 1);
         }
     }
 
@@ -171,6 +215,10 @@ void MenuHandlerCB(void * /*mRef*/, void * iRef)
             XPLMReloadPlugins();
             break;
 #endif
+        default:
+            // additional channels
+            if (m >= MENU_ID_TOGGLE_CHN_BASE)
+                dataRefs.ToggleActOnCom(int(m - MENU_ID_TOGGLE_CHN_BASE));
         }
     }
     catch (const std::exception& e) {
@@ -200,6 +248,14 @@ bool MenuRegisterItems ()
     aMenuItems[MENU_ID_TOGGLE_COM2] =
     LT_AppendMenuItem(menuID, MENU_TOGGLE_COM2, (void *)MENU_ID_TOGGLE_COM2,
                       dataRefs.cmdPLA[CR_MONITOR_COM2]);
+    // ...and additional channels as defined in the config file
+    aMenuItemsChn.clear();
+    for (int idx = COM_CNT_XP; idx < dataRefs.GetComCnt(); idx++) {
+        char buf[50];
+        snprintf(buf, sizeof(buf), MENU_TOGGLE_CHN, idx+1);
+        aMenuItemsChn.push_back(
+            XPLMAppendMenuItem(menuID, buf, (void *)(MENU_ID_TOGGLE_CHN_BASE + idx), 1));
+    }
 
     // Audio Device sub menu
     MenuAudioDevices();
@@ -228,6 +284,12 @@ bool MenuRegisterItems ()
             return false;
         }
     }
+    for (int item: aMenuItemsChn) {
+        if ( item<0 ) {
+            LOG_MSG(logERR,ERR_APPEND_MENU_ITEM);
+            return false;
+        }
+    }
 
     // update the checkmarks so that selected options are marked
     MenuUpdateCheckmarks();
@@ -262,12 +324,26 @@ int CommandHandlerMenuItems (XPLMCommandRef       /*inCommand*/,
     return 1;
 }
 
+/// "Say again": replay the last transmission of a channel
+int CommandHandlerSayAgain (XPLMCommandRef       /*inCommand*/,
+                            XPLMCommandPhase     inPhase,
+                            void *               inRefcon) // contains the channel index
+{
+    if (inPhase == xplm_CommandBegin)
+        COMChannel::SayAgain(int(reinterpret_cast<intptr_t>(inRefcon)));
+    return 1;
+}
+
 bool RegisterCommandHandlers ()
 {
     for (cmdMenuMap i: CMD_MENU_MAP)
         XPLMRegisterCommandHandler(dataRefs.cmdPLA[i.cmd],
                                    CommandHandlerMenuItems,
                                    1, (void*)i.menu);
+    XPLMRegisterCommandHandler(dataRefs.cmdPLA[CR_SAY_AGAIN_COM1],
+                               CommandHandlerSayAgain, 1, (void*)0);
+    XPLMRegisterCommandHandler(dataRefs.cmdPLA[CR_SAY_AGAIN_COM2],
+                               CommandHandlerSayAgain, 1, (void*)1);
     return true;
 }
 
@@ -275,39 +351,117 @@ bool RegisterCommandHandlers ()
 // MARK: Flight loop callbacks
 //
 
-// callback called every second to identify COM frequency changes
+/// Called once VLC has been initialized, from the flight loop after the
+/// background initialization, or after a re-init from the settings UI
+void VLCInitDone ()
+{
+    // mix all streams into one OpenAL output?
+    if (dataRefs.ShallUseAudioMixer())
+        gMixer.Start(std::string());
+    else
+        gMixer.Stop();
+    
+    // Set initial audio output device as read from configuration
+    MenuAudioDevices();
+    COMChannel::SetAllAudioDevice(dataRefs.GetAudioDev());
+    gMixer.SetRoutes(dataRefs.GetAudioRoutes());
+    gMixer.SetDuckGain(float(dataRefs.GetAudioDuckPct()) / 100.0f);
+    // output a list of known device into the log
+    if (dataRefs.GetLogLevel() == logDEBUG) {
+        LOG_MSG(logDEBUG, DBG_AVAIL_AUDIO_DEVICE);
+        for (const VLC::AudioOutputDeviceDescription& dev : gVLCOutputDevs) {
+            LOG_MSG(logDEBUG, (dev.device() + " " + dev.description()).c_str());
+        }
+    }
+}
+
+/// Called every frame to feed the audio mixer's output
+float PLAAudioCB (float, float, int, void*)
+{
+    gMixer.Pump();
+    return -1.0f;
+}
+
+/// Flight loop interval mode currently in use: 0 - fast, 1 - normal, 2 - idle
+static int loopMode = 1;
+/// Flight loop statistics: number of calls with fast, normal, and idle interval
+static unsigned long loopCnt[3] = {0, 0, 0};
+
+/// @brief Callback identifying COM frequency changes, called with an adaptive interval
+/// @details Frequency checks are cheap integer compares, so the callback
+///          runs every 100ms while something is going on (tuning, buffering,
+///          desyncing, knobs moving), otherwise once a second, and only
+///          every few seconds when parked and nothing changed for a while.
+///          The channels' regular tick stays at once a second (or slower when idle),
+///          their expensive checks are jobs in the timer wheel `gTimers`.
 float PLAFlightLoopCB (float, float, int, void*)
 {
+    using namespace std::chrono;
+    const steady_clock::time_point now = steady_clock::now();
+    static steady_clock::time_point tLastTick;
+    static steady_clock::time_point tLastChange = now;
+    static steady_clock::time_point tLastAudioDev = now;
+    
+    // time for a regular tick?
+    const bool bTick = now - tLastTick >= milliseconds(PLA_TICK_MS);
+    if (bTick) {
+        tLastTick = now;
+        // where are we in the flight?
+        gPhase.Update();
+    }
     
-    // loop over all COM radios we support
-    for (COMChannel& chn: gChn) {
-        const int idx = chn.GetIdx();
-        // should we actually _act_ on that COM radio?
-        if (dataRefs.ShallActOnCom(idx)) {
-            // yes, consider this COM radio
-            chn.RegularMaintenance();
-        } else {
-            // do _not_ consider this COM
+    // VLC initialization done in the meantime? Then finish setup
+    if (COMChannel::CheckVLCInit())
+        VLCInitDone();
+    
+    // execute the channels' due jobs like airport checks and pre-buffering
+    gTimers.Advance();
+    
+    // loop over all channels configured
+    bool bAnyActive = false, bBusy = false;
+    for (int idx = 0; idx < dataRefs.GetComCnt(); idx++) {
+        // should we actually _act_ on that channel?
+        if (dataRefs.ShallActOnCom(idx) && dataRefs.GetComFreq(idx) > 0) {
+            // yes, consider this channel, create it on first use
+            COMChannel* pChn = COMChannel::Get(idx, true);
+            if (pChn->RegularMaintenance(bTick))
+                tLastChange = now;
+            bBusy |= pChn->IsTransitioning();
+            bAnyActive = true;
+        } else if (COMChannel* pChn = COMChannel::Get(idx)) {
+            // do _not_ consider this channel
             // stop if it is running
-            if (chn.IsDefined())
-                chn.ClearChannel();
+            pChn->ClearChannel();
         }
-        
     }
     
-    // if there is no ATIS channel playing then make sure XP can play ATIS
-    if (!COMChannel::AnyATISPlaying())
-        dataRefs.EnableXPsATIS(true);
+    // prefetch streams if the flight plan or tuned airports changed
+    if (bTick)
+        gPrefetch.CheckAirports();
+    
+    // XP can play ATIS unless a channel plays LiveATC's ATIS instead
+    dataRefs.EnableXPsATIS(!COMChannel::AnyXPAtisSuppressed());
 
     // every minute update the list of audio output devices
-    static int callCount = 0;
-    if (++callCount >= 60) {
-        callCount = 0;
+    if (now - tLastAudioDev >= seconds(PLA_AUDIO_DEV_S)) {
+        tLastAudioDev = now;
         MenuAudioDevices();
     }
     
-    // call me again in a second
-    return 1.0f;
+    // determine when to call me next
+    int mode = 1;
+    if (bBusy || now - tLastChange < seconds(PLA_KNOB_HOLD_S))
+        mode = 0;
+    else if (now - tLastChange >= seconds(PLA_IDLE_AFTER_S) &&
+             (!bAnyActive || gPhase.GetPhase() == PHASE_PARKED))
+        mode = 2;
+    static const float LOOP_INTERVALS[3] = { PLA_LOOP_FAST, PLA_LOOP_NORMAL, PLA_LOOP_IDLE };
+    loopCnt[mode]++;
+    if (mode != loopMode) {
+        loopMode = mode;
+        LOG_MSG(logDEBUG, DBG_LOOP_INTERVAL, LOOP_INTERVALS[mode]);
+    }
+    return LOOP_INTERVALS[mode];
 }
 
 
@@ -397,22 +551,23 @@ PLUGIN_API int  XPluginEnable(void)
     SHOW_MSG(logWARN, DBG_DEBUG_BUILD);
 #endif
     
-    // Initialize all VLC instances
-    COMChannel::InitAllVLC();
-
-    // Set initial audio output device as read from configuration
-    MenuAudioDevices();
-    COMChannel::SetAllAudioDevice(dataRefs.GetAudioDev());
-    // output a list of known device into the log
-    if (dataRefs.GetLogLevel() == logDEBUG) {
-        LOG_MSG(logDEBUG, DBG_AVAIL_AUDIO_DEVICE);
-        for (const VLC::AudioOutputDeviceDescription& dev : gVLCOutputDevs) {
-            LOG_MSG(logDEBUG, (dev.device() + " " + dev.description()).c_str());
-        }
-    }
+    const std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    
+    // start the worker threads: one per channel plus one for prefetching,
+    // and the reaper for stopping streams in the background
+    gWorkers.Start(dataRefs.GetComCnt() + 1);
+    gReaper.Start();
+    
+    // Initialize VLC in the background, see VLCInitDone()
+    COMChannel::InitAllVLCAsync();
     
     // start the actual processing
     XPLMRegisterFlightLoopCallback(PLAOneTimeCB, -1, NULL);
+    XPLMRegisterFlightLoopCallback(PLAAudioCB, -1, NULL);
+    LOSStart();
+    AirportsStart();
+    LOG_MSG(logINFO, MSG_ENABLED,
+            std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - tStart).count());
     return 1;
 }
 
@@ -420,10 +575,21 @@ PLUGIN_API void XPluginDisable(void)
 {
     // make sure all children are stopped and cleanp up
     COMChannel::CleanupAllVLC();
+    gMixer.Stop();
+    gTimers.Clear();
     
     // cleanup
     XPLMUnregisterFlightLoopCallback(PLAOneTimeCB, NULL);
     XPLMUnregisterFlightLoopCallback(PLAFlightLoopCB, NULL);
+    XPLMUnregisterFlightLoopCallback(PLAAudioCB, NULL);
+    // workers first, they might still look up airports or line of sight
+    gPrefetch.Stop();
+    gWorkers.Stop();
+    gReaper.Stop();
+    LOSStop();
+    AirportsStop();
+    LOG_MSG(logINFO, MSG_LOOP_STATS, loopCnt[0] + loopCnt[1] + loopCnt[2],
+            loopCnt[0], loopCnt[1], loopCnt[2]);
     LOG_MSG(logMSG, MSG_DISABLED);
 }
 
@@ -451,6 +617,12 @@ PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFrom, int inMsg, void * inP
         case XPLM_MSG_EXITING_VR:
             // move eligible windows out of VR
             break;
+            
+            // *** user's plane loaded: a new flight begins ***
+        case XPLM_MSG_PLANE_LOADED:
+            if (inParam == 0)
+                gPhase.Reset();
+            break;
     }
     
 }
@@ -106,6 +106,9 @@ enum UI_WIDGET_IDX_T {
 
     UI_ADVCD_CAP_MAX_RADIO_DIST,
     UI_ADVCD_TXT_MAX_RADIO_DIST,
+    UI_ADVCD_BTN_RADIO_HORIZON,
+    UI_ADVCD_BTN_TERRAIN_LOS,
+    UI_ADVCD_BTN_PREFETCH_FPLAN,
 
     // always last: number of UI elements
     UI_NUMBER_OF_ELEMENTS
@@ -170,6 +173,9 @@ TFWidgetCreate_t SETTINGS_UI[] =
 
     {   5, 150, 195,  10, 1, "Max radio distance: [nm]", 0, UI_ADVCD_SUB_WND, xpWidgetClass_Caption, {0,0, 0,0, 0,0} },
     { 200, 150,  50,  15, 1, "",                    0, UI_ADVCD_SUB_WND, xpWidgetClass_TextField, {xpProperty_MaxCharacters,3, 0,0, 0,0} },
+    {  10, 170,  10,  10, 1, "Limit radio distance by radio horizon",0, UI_ADVCD_SUB_WND, xpWidgetClass_Button, {xpProperty_ButtonType, xpRadioButton, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox, 0,0} },
+    {  10, 185,  10,  10, 1, "Stations can be masked by terrain",0, UI_ADVCD_SUB_WND, xpWidgetClass_Button, {xpProperty_ButtonType, xpRadioButton, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox, 0,0} },
+    {  10, 205,  10,  10, 1, "Prefetch streams for flight plan airports",0, UI_ADVCD_SUB_WND, xpWidgetClass_Button, {xpProperty_ButtonType, xpRadioButton, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox, 0,0} },
 };
 
 constexpr int NUM_WIDGETS = sizeof(SETTINGS_UI)/sizeof(SETTINGS_UI[0]);
@@ -278,6 +284,12 @@ void LTSettingsUI::Enable()
         txtMaxRadioDist.setId(widgetIds[UI_ADVCD_TXT_MAX_RADIO_DIST]);
         txtMaxRadioDist.tfFormat = TFTextFieldWidget::TFF_DIGITS;
         txtMaxRadioDist.SetDescriptor(dataRefs.GetMaxRadioDist());
+        btnRadioHorizon.setId(widgetIds[UI_ADVCD_BTN_RADIO_HORIZON]);
+        btnRadioHorizon.SetChecked(dataRefs.ShallUseRadioHorizon());
+        btnTerrainLOS.setId(widgetIds[UI_ADVCD_BTN_TERRAIN_LOS]);
+        btnTerrainLOS.SetChecked(dataRefs.ShallCheckTerrainLOS());
+        btnPrefetchFPlan.setId(widgetIds[UI_ADVCD_BTN_PREFETCH_FPLAN]);
+        btnPrefetchFPlan.SetChecked(dataRefs.ShallPrefetchFlightPlan());
 
         // set current values
         UpdateValues();
@@ -323,7 +335,7 @@ void LTSettingsUI::UpdateValues ()
     // *** Basics ***
     
     // are COMs selected?
-    for (int idx = 0; idx < COM_CNT; idx++)
+    for (int idx = 0; idx < COM_CNT_XP; idx++)
         btnBasicsCom[idx].SetChecked(dataRefs.ShallActOnCom(idx));
 
     // Volume
@@ -337,10 +349,10 @@ void LTSettingsUI::UpdateValues ()
     capLTIntegration.SetDescriptor(buf);
     
     // full status of COM1/2 channels
-    capCOM1Status.SetDescriptor(gChn[0].Summary());
-    capCOM1StatusStby.SetDescriptor(gChn[0].Summary(true));
-    capCOM2Status.SetDescriptor(gChn[1].Summary());
-    capCOM2StatusStby.SetDescriptor(gChn[1].Summary(true));
+    capCOM1Status.SetDescriptor(COMChannel::GetSummary(0));
+    capCOM1StatusStby.SetDescriptor(COMChannel::GetSummary(0, true));
+    capCOM2Status.SetDescriptor(COMChannel::GetSummary(1));
+    capCOM2StatusStby.SetDescriptor(COMChannel::GetSummary(1, true));
 
     // *** Advanced ***
     logLevelGrp.SetCheckedIndex(dataRefs.GetLogLevel());
@@ -408,7 +420,7 @@ bool LTSettingsUI::MsgButtonStateChanged (XPWidgetID buttonWidget, bool bNowChec
     // *** Basics ***
     
     // Save value for "watch COM#"
-    for (int idx = 0; idx < COM_CNT; idx++) {
+    for (int idx = 0; idx < COM_CNT_XP; idx++) {
         if (btnBasicsCom[idx] == buttonWidget) {
             dataRefs.SetActOnCom(idx, bNowChecked);
             return true;
@@ -441,6 +453,12 @@ bool LTSettingsUI::MsgButtonStateChanged (XPWidgetID buttonWidget, bool bNowChec
     if (btnKeepPrevWhileDesync == buttonWidget) { dataRefs.SetRunPrevFrequTillDesync(bNowChecked); return true; }
     // Pre-buffer standby frequency?
     if (btnPreBufferStandbyFrequ == buttonWidget) { dataRefs.SetPreBufferSTandbyFrequ(bNowChecked); return true; }
+    // Limit reach by radio horizon?
+    if (btnRadioHorizon == buttonWidget) { dataRefs.SetUseRadioHorizon(bNowChecked); return true; }
+    // Check terrain line of sight?
+    if (btnTerrainLOS == buttonWidget) { dataRefs.SetCheckTerrainLOS(bNowChecked); return true; }
+    // Prefetch streams for the flight plan?
+    if (btnPrefetchFPlan == buttonWidget) { dataRefs.SetPrefetchFlightPlan(bNowChecked); return true; }
 
     return bRet;
 }
@@ -487,7 +505,9 @@ void LTSettingsUI::ValidateUpdateVLCPath (const std::string newPath)
     
     // no matter what, we safe the result and try to re-init VLC
     dataRefs.SetVLCPath(newPath);
-    if (!COMChannel::InitAllVLC())
+    if (COMChannel::InitAllVLC())
+        VLCInitDone();              // re-apply menu, audio devices, and mixer
+    else
         capValidatePath.SetDescriptor(capValidatePath.GetDescriptor() + MSG_VLC_INIT_FAILED);
 }
 #endif
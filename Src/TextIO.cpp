@@ -116,15 +116,16 @@ void    draw_msg(XPLMWindowID in_window_id, void * /*in_refcon*/)
     // display desync countdown?
     bool bNeedWndForCountdown = false;
     if (dataRefs.GetMsgAreaLevel() <= logINFO)
-        for (COMChannel& chn: gChn) {
-            const StreamCtrlTy& strm = chn.GetStreamCtrlData();
-            if (strm.IsDesyncing() && !strm.streamName.empty())
+        for (const COMChannel& chn: gChn) {
+            // wait-free copy of the channel's status
+            const ChnStatusTy st = chn.GetStatusSnapshot();
+            if (st.IsDesyncing() && st.streamName[0])
             {
-                char buf[50];
+                char buf[100];
                 snprintf(buf, sizeof(buf), MSG_COM_COUNTDOWN,
                          chn.GetIdx()+1,
-                         strm.GetSecTillDesyncDone(),
-                         strm.streamName.c_str());
+                         st.GetSecTillDesyncDone(),
+                         st.streamName);
                 // draw text, take color based on msg level
                 XPLMDrawString(COL_LVL[logINFO], l, t,
                                buf,